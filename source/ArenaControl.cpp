@@ -2,7 +2,9 @@
 
 #include "ArenaControl.h"
 
+#include "ArenaSimulation.h"
 #include "Editor.h"
+#include "Files.h"
 #include "Fleet.h"
 #include "imgui_ex.h"
 #include "Ship.h"
@@ -12,14 +14,23 @@
 #include <imgui_internal.h>
 #include <imgui_stdlib.h>
 
+#include <algorithm>
+#include <chrono>
 #include <map>
 
 using namespace std;
 
+namespace {
+	// The balance battles run for this long every frame, a few frames at a time.
+	constexpr auto SIMULATION_TIME = chrono::milliseconds(10);
+	constexpr int SIMULATION_FRAMES = 10;
+}
+
 
 
 ArenaControl::ArenaControl(Editor &editor, SystemEditor &systemEditor)
-	: editor(editor), systemEditor(systemEditor)
+	: editor(editor), systemEditor(systemEditor), replayPath(Files::Config() + "arena replay.txt"),
+	timingsPath(Files::Config() + "arena timings.csv")
 {}
 
 
@@ -48,10 +59,13 @@ void ArenaControl::Render(bool &show)
 		arenaPtr->paused = !arenaPtr->paused;
 	ImGui::SameLine();
 	if(ImGui::Button("Clear Ships"))
-		arenaPtr->Execute([arenaPtr]
-			{
-				arenaPtr->engine.ships.clear();
-			});
+		arenaPtr->ClearShips();
+	if(arenaPtr->paused)
+	{
+		ImGui::SameLine();
+		if(ImGui::Button("Step Frame"))
+			arenaPtr->StepFrame();
+	}
 
 	ImGui::Spacing();
 
@@ -79,10 +93,7 @@ void ArenaControl::Render(bool &show)
 	if(!ship || !gov)
 		ImGui::BeginDisabled();
 	if(ImGui::Button("Spawn"))
-		arenaPtr->Execute([this, amount] {
-			for(int i = 0; i < amount; ++i)
-				PlaceShip(*ship, *gov);
-		});
+		arenaPtr->SpawnShips(*ship, *gov, amount);
 	if(!ship || !gov)
 		ImGui::EndDisabled();
 
@@ -115,29 +126,184 @@ void ArenaControl::Render(bool &show)
 	if(!fleet || !fleetgov)
 		ImGui::BeginDisabled();
 	if(ImGui::Button("Spawn##fleet"))
-		arenaPtr->Execute([this, amount] {
-			for(int i = 0; i < amount; ++i)
-				for(const auto &ship : fleet->variants.Get().Ships())
-					PlaceShip(*ship, *fleetgov);
-		});
+		arenaPtr->SpawnFleets(*fleet, *fleetgov, amount);
 	if(!fleet || !fleetgov)
 		ImGui::EndDisabled();
 
 	ImGui::SameLine();
 	ImGui::Text("x%d", amount);
+
+	// A recording stores the spawn rate it was made with, so it can't change
+	// during one.
+	const bool fixedRate = arenaPtr->IsRecording() || arenaPtr->IsReplaying();
+	if(fixedRate)
+		ImGui::BeginDisabled();
+	ImGui::SliderInt("ships per frame", &ArenaPanel::spawnRate, 1, 1000, "%d", ImGuiSliderFlags_AlwaysClamp);
+	if(fixedRate)
+		ImGui::EndDisabled();
+	if(const size_t queued = arenaPtr->QueuedShips())
+		ImGui::Text("%zu ships waiting to spawn", queued);
+
+	ImGui::Spacing();
+	ImGui::Separator();
+	RenderReplay(*arenaPtr);
+
+	ImGui::Spacing();
+	ImGui::Separator();
+	RenderTimings(*arenaPtr);
+	ImGui::Spacing();
+	ImGui::Separator();
+	RenderSimulation(*arenaPtr, ship, gov, fleet, fleetgov);
 	ImGui::End();
 }
 
 
 
-void ArenaControl::PlaceShip(const Ship &ship, const Government &gov) const
+void ArenaControl::RenderReplay(ArenaPanel &arena)
+{
+	ImGui::InputScalar("seed", ImGuiDataType_U64, &replaySeed);
+	ImGui::InputText("replay file", &replayPath);
+
+	if(!arena.IsRecording())
+	{
+		if(ImGui::Button("Record"))
+			arena.StartRecording(replaySeed);
+	}
+	else if(ImGui::Button("Save Recording"))
+		arena.SaveRecording(replayPath);
+	ImGui::SameLine();
+	if(!arena.IsReplaying())
+	{
+		if(ImGui::Button("Replay"))
+			replayFailed = !arena.StartReplay(replayPath);
+	}
+	else if(ImGui::Button("Stop Replay"))
+		arena.StopReplay();
+
+	if(replayFailed)
+		ImGui::TextColored(ImVec4(1.f, .3f, .3f, 1.f), "\"%s\" is not a valid replay.", replayPath.c_str());
+	if(arena.IsRecording())
+		ImGui::Text("Recording frame %d", arena.Frame());
+	else if(arena.IsReplaying())
+	{
+		ImGui::Text("Replaying frame %d/%d", arena.Frame(), arena.ReplayFrames());
+		ImGui::SliderInt("speed", &ArenaPanel::replaySpeed, 1, 32, "x%d");
+	}
+}
+
+
+
+void ArenaControl::RenderTimings(ArenaPanel &arena)
 {
-	auto newShip = make_shared<Ship>(ship);
-	newShip->SetName(ship.TrueName());
-	newShip->SetSystem(systemEditor.Selected());
-	newShip->SetGovernment(&gov);
-	newShip->SetPersonality(Personality::STAYING | Personality::UNINTERESTED);
-
-	Fleet::Place(*systemEditor.Selected(), *newShip);
-	arena.lock()->engine.Place(newShip);
+	ImGui::Checkbox("Show Frame Timings", &ArenaPanel::showTimings);
+	ImGui::InputText("timings file", &timingsPath);
+	if(!arena.IsCapturingTimings())
+	{
+		if(ImGui::Button("Capture Timings"))
+			arena.StartTimingCapture();
+	}
+	else
+	{
+		if(ImGui::Button("Save Timings"))
+			arena.SaveTimings(timingsPath);
+		ImGui::SameLine();
+		ImGui::Text("%zu frames", arena.CapturedTimings());
+	}
+}
+
+
+
+void ArenaControl::RenderSimulation(ArenaPanel &arena, const Ship *ship, const Government *gov,
+		const Fleet *fleet, const Government *fleetGov)
+{
+	ImGui::Text("Balance battles of the ships against the fleets:");
+	ImGui::InputInt("ships", &simulateShips);
+	ImGui::InputInt("fleets", &simulateFleets);
+	ImGui::InputInt("runs", &simulateRuns);
+	ImGui::InputInt("max seconds", &simulateSeconds);
+	simulateShips = max(0, simulateShips);
+	simulateFleets = max(0, simulateFleets);
+	simulateRuns = max(1, simulateRuns);
+	simulateSeconds = max(1, simulateSeconds);
+
+	if(battle)
+	{
+		// The battles use the game's global state just like the arena, so the arena
+		// can't be calculating a frame while they run.
+		arena.engine.Wait();
+		const auto start = chrono::steady_clock::now();
+		while(battle && chrono::steady_clock::now() - start < SIMULATION_TIME)
+			if(battle->Step(SIMULATION_FRAMES))
+			{
+				summary.Add(battle->GetResult());
+				battle.reset();
+				if(++simulationRun < simulation.Runs())
+					battle = make_unique<ArenaSimulation::Battle>(simulation, simulationRun);
+			}
+	}
+
+	// The battles are seeded, and would change the random numbers of a recording.
+	const bool isRunning = battle != nullptr;
+	const bool canSimulate = !isRunning && !arena.IsRecording() && !arena.IsReplaying()
+		&& systemEditor.Selected() && ship && gov && fleet && fleetGov && gov != fleetGov
+		&& simulateShips && simulateFleets;
+	if(!canSimulate)
+		ImGui::BeginDisabled();
+	if(ImGui::Button("Simulate"))
+	{
+		simulation = ArenaSimulation();
+		simulation.SetSystem(systemEditor.Selected());
+		simulation.SetFrames(simulateSeconds * 60);
+		simulation.SetRuns(simulateRuns);
+		simulation.AddShips(gov, ship, simulateShips);
+		simulation.AddFleets(fleetGov, fleet, simulateFleets);
+
+		summaryGovernments = simulation.Governments();
+		summary = ArenaSimulation::Summary();
+		summary.wins.resize(summaryGovernments.size());
+		summary.winFrames.resize(summaryGovernments.size());
+		simulationRun = 0;
+		arena.engine.Wait();
+		battle = make_unique<ArenaSimulation::Battle>(simulation, simulationRun);
+	}
+	if(!canSimulate)
+		ImGui::EndDisabled();
+
+	if(battle)
+	{
+		ImGui::SameLine();
+		if(ImGui::Button("Stop"))
+			battle.reset();
+		ImGui::SameLine();
+		const int runs = simulation.Runs();
+		const string progress = to_string(simulationRun) + "/" + to_string(runs);
+		ImGui::ProgressBar(static_cast<float>(simulationRun) / runs, ImVec2(-1.f, 0.f), progress.c_str());
+	}
+
+	if(!summary.runs || !ImGui::BeginTable("simulation results", 4, ImGuiTableFlags_Borders))
+		return;
+
+	ImGui::TableSetupColumn("side");
+	ImGui::TableSetupColumn("wins");
+	ImGui::TableSetupColumn("win rate");
+	ImGui::TableSetupColumn("time to kill");
+	ImGui::TableHeadersRow();
+
+	auto row = [this](const string &side, int wins, double winFrames)
+	{
+		ImGui::TableNextRow();
+		ImGui::TableNextColumn();
+		ImGui::TextUnformatted(side.c_str());
+		ImGui::TableNextColumn();
+		ImGui::Text("%d", wins);
+		ImGui::TableNextColumn();
+		ImGui::Text("%.1f%%", 100. * wins / summary.runs);
+		ImGui::TableNextColumn();
+		if(wins && winFrames)
+			ImGui::Text("%.1f s", winFrames / wins / 60.);
+	};
+	for(size_t i = 0; i < summaryGovernments.size() && i < summary.wins.size(); ++i)
+		row(summaryGovernments[i]->TrueName(), summary.wins[i], summary.winFrames[i]);
+	row("(draw)", summary.draws, 0.);
+	ImGui::EndTable();
 }
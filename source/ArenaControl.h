@@ -3,10 +3,16 @@
 #ifndef ARENA_CONTROL_H_
 #define ARENA_CONTROL_H_
 
+#include "ArenaSimulation.h"
+
+#include <cstdint>
 #include <memory>
+#include <string>
+#include <vector>
 
 class ArenaPanel;
 class Editor;
+class Fleet;
 class Government;
 class Ship;
 class SystemEditor;
@@ -23,7 +29,13 @@ public:
 
 
 private:
-	void PlaceShip(const Ship &ship, const Government &gov) const;
+	// Renders the buttons for recording and replaying battles.
+	void RenderReplay(ArenaPanel &arena);
+	// Renders the buttons for capturing the frame timings of the arena.
+	void RenderTimings(ArenaPanel &arena);
+	// Renders the settings and the results of the balance battles.
+	void RenderSimulation(ArenaPanel &arena, const Ship *ship, const Government *gov, const Fleet *fleet,
+		const Government *fleetGov);
 
 
 private:
@@ -31,6 +43,26 @@ private:
 	SystemEditor &systemEditor;
 
 	std::weak_ptr<ArenaPanel> arena;
+
+	uint64_t replaySeed = 0;
+	std::string replayPath;
+	// Whether the last replay file could not be loaded.
+	bool replayFailed = false;
+	std::string timingsPath;
+
+	// The balance battles that are running, if any. They run a few frames every
+	// frame, so that the objects they use can't be edited in the middle of a frame.
+	ArenaSimulation simulation;
+	std::unique_ptr<ArenaSimulation::Battle> battle;
+	int simulationRun = 0;
+	// The results of the last balance battles, or of the ones that are running.
+	ArenaSimulation::Summary summary;
+	std::vector<const Government *> summaryGovernments;
+
+	int simulateShips = 1;
+	int simulateFleets = 1;
+	int simulateRuns = 100;
+	int simulateSeconds = 300;
 };
 
 
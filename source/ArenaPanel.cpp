@@ -2,6 +2,8 @@
 
 #include "ArenaPanel.h"
 
+#include "Angle.h"
+#include "ArenaSimulation.h"
 #include "comparators/ByGivenOrder.h"
 #include "BoardingPanel.h"
 #include "Dialog.h"
@@ -9,6 +11,8 @@
 #include "text/Font.h"
 #include "text/FontSet.h"
 #include "text/Format.h"
+#include "Files.h"
+#include "Fleet.h"
 #include "FrameTimer.h"
 #include "GameData.h"
 #include "Government.h"
@@ -36,12 +40,33 @@
 #include "opengl.h"
 
 #include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <iomanip>
+#include <map>
 #include <sstream>
 #include <string>
 
 using namespace std;
 
+namespace {
+	using Clock = chrono::steady_clock;
+
+	// The number of frames the timing overlay shows the average and maximum of.
+	constexpr size_t TIMING_FRAMES = 60;
+	// The distance from the first ship of a fleet that its other ships are placed at.
+	constexpr double FORMATION_RADIUS = 400.;
+
+	// Returns the milliseconds since the given time, and sets it to now.
+	double Lap(Clock::time_point &time)
+	{
+		const auto now = Clock::now();
+		const double elapsed = chrono::duration<double, milli>(now - time).count();
+		time = now;
+		return elapsed;
+	}
+}
+
 
 
 void ArenaPanel::RenderProperties(SystemEditor &systemEditor, bool &show)
@@ -75,6 +100,7 @@ void ArenaPanel::RenderProperties(SystemEditor &systemEditor, bool &show)
 		Preferences::Set("Show status overlays", showStatusOverlays);
 	if(ImGui::Checkbox("Show Chat", &showChat))
 		Preferences::Set("editor - show chat", showChat);
+	ImGui::Checkbox("Show Frame Timings", &showTimings);
 
 	ImGui::End();
 }
@@ -108,31 +134,71 @@ void ArenaPanel::Step()
 	if(player.GetSystem())
 		const_cast<System *>(player.GetSystem())->SetDate(currentDate);
 
-	engine.Wait();
-
 	// Depending on what UI element is on top, the game is "paused." This
 	// checks only already-drawn panels.
-	bool isActive = !paused && GetUI()->IsTop(this);
+	bool isActive = (!paused || stepFrame) && GetUI()->IsTop(this);
+	stepFrame = false;
 
-	engine.Step(isActive);
+	// Replays can run faster than real time.
+	const int steps = isActive && isReplaying ? max(1, replaySpeed) : 1;
+	for(int i = 0; i < steps; ++i)
+	{
+		FrameTiming timing;
+		timing.frame = frame;
+		auto time = Clock::now();
+		engine.Wait();
+		timing.wait = Lap(time);
+
+		// Execute any commands. This happens before the engine steps, so that the
+		// commands of a replay run at the same point of the frame as they did
+		// when they were recorded.
+		for(const auto &f : commands)
+			f();
+		commands.clear();
+		// Ships are only spawned while the arena runs, so that they appear on
+		// the frame they are placed on and a recording replays them on it too.
+		if(isActive)
+		{
+			if(isReplaying)
+				RunReplay();
+			PlaceQueuedShips();
+		}
+		timing.commands = Lap(time);
 
-	// Execute any commands.
-	for(const auto &f : commands)
-		f();
-	commands.clear();
+		engine.Step(isActive);
+		timing.step = Lap(time);
 
-	// Splice new events onto the eventQueue for (eventual) handling. No
-	// other classes use Engine::Events() after Engine::Step() completes.
-	eventQueue.splice(eventQueue.end(), engine.Events());
-	// Handle as many ShipEvents as possible (stopping if no longer active
-	// and updating the isActive flag).
-	StepEvents(isActive);
+		// Splice new events onto the eventQueue for (eventual) handling. No
+		// other classes use Engine::Events() after Engine::Step() completes.
+		eventQueue.splice(eventQueue.end(), engine.Events());
+		// Handle as many ShipEvents as possible (stopping if no longer active
+		// and updating the isActive flag).
+		StepEvents(isActive);
+		timing.events = Lap(time);
 
-	if(isActive)
+		if(!isActive)
+			break;
 		engine.Go();
-	else
+		++frame;
+
+		timing.ships = engine.ships.size();
+		timing.projectiles = engine.projectiles.size();
+		timing.visuals = engine.visuals.size();
+		AddTiming(timing);
+
+		// Pause at the end of a replay.
+		if(isReplaying && frame >= replay.Frames())
+		{
+			isReplaying = false;
+			paused = true;
+			break;
+		}
+	}
+
+	if(!isActive)
 		canDrag = false;
-	canClick = isActive;
+	// Clicks would change the outcome of a replay.
+	canClick = isActive && !isReplaying;
 }
 
 
@@ -142,7 +208,16 @@ void ArenaPanel::Draw()
 	FrameTimer loadTimer;
 	glClear(GL_COLOR_BUFFER_BIT);
 
+	auto time = Clock::now();
 	engine.Draw();
+	if(!recentTimings.empty())
+	{
+		recentTimings.back().draw = Lap(time);
+		if(isCapturingTimings && !capturedTimings.empty())
+			capturedTimings.back().draw = recentTimings.back().draw;
+	}
+	if(showTimings)
+		DrawTimings();
 
 	if(Preferences::Has("Show CPU / GPU load"))
 	{
@@ -181,6 +256,203 @@ void ArenaPanel::Execute(function<void()> f)
 
 
 
+void ArenaPanel::SpawnShips(const Ship &ship, const Government &gov, int amount)
+{
+	if(isReplaying)
+		return;
+
+	Execute([this, &ship, &gov, amount]
+		{
+			ArenaReplay::Command command;
+			command.type = ArenaReplay::Command::Type::SHIPS;
+			command.name = ship.VariantName();
+			command.government = gov.TrueName();
+			command.amount = amount;
+			Record(command);
+
+			PlaceShips(ship, gov, amount);
+		});
+}
+
+
+
+void ArenaPanel::SpawnFleets(const Fleet &fleet, const Government &gov, int amount)
+{
+	if(isReplaying)
+		return;
+
+	Execute([this, &fleet, &gov, amount]
+		{
+			ArenaReplay::Command command;
+			command.type = ArenaReplay::Command::Type::FLEETS;
+			command.name = fleet.Name();
+			command.government = gov.TrueName();
+			command.amount = amount;
+			Record(command);
+
+			PlaceFleets(fleet, gov, amount);
+		});
+}
+
+
+
+void ArenaPanel::ClearShips()
+{
+	if(isReplaying)
+		return;
+
+	Execute([this]
+		{
+			ArenaReplay::Command command;
+			command.type = ArenaReplay::Command::Type::CLEAR;
+			Record(command);
+
+			engine.ships.clear();
+			spawnQueue.clear();
+		});
+}
+
+
+
+size_t ArenaPanel::QueuedShips() const
+{
+	size_t count = 0;
+	for(const auto &batch : spawnQueue)
+		count += batch->ships.size() - batch->placed;
+	return count;
+}
+
+
+
+void ArenaPanel::StartRecording(uint64_t seed)
+{
+	Execute([this, seed]
+		{
+			const System *system = player.GetSystem();
+			Restart(seed, system);
+			replay.Clear(seed, system->Name());
+			replay.SetSpawnRate(spawnRate);
+			isRecording = true;
+			isReplaying = false;
+		});
+}
+
+
+
+void ArenaPanel::SaveRecording(const string &path)
+{
+	if(!isRecording)
+		return;
+
+	replay.SetFrames(frame);
+	replay.Save(path);
+	isRecording = false;
+}
+
+
+
+bool ArenaPanel::StartReplay(const string &path)
+{
+	ArenaReplay loaded;
+	if(!loaded.Load(path))
+		return false;
+	const System *system = editor.Universe().systems.Find(loaded.SystemName());
+	if(!system)
+		return false;
+
+	replay = std::move(loaded);
+	isRecording = false;
+	Execute([this, system]
+		{
+			Restart(replay.Seed(), system);
+			isReplaying = true;
+		});
+	paused = false;
+	return true;
+}
+
+
+
+void ArenaPanel::StopReplay()
+{
+	isReplaying = false;
+}
+
+
+
+bool ArenaPanel::IsRecording() const
+{
+	return isRecording;
+}
+
+
+
+bool ArenaPanel::IsReplaying() const
+{
+	return isReplaying;
+}
+
+
+
+int ArenaPanel::Frame() const
+{
+	return frame;
+}
+
+
+
+int ArenaPanel::ReplayFrames() const
+{
+	return replay.Frames();
+}
+
+
+
+void ArenaPanel::StepFrame()
+{
+	stepFrame = true;
+}
+
+
+
+void ArenaPanel::StartTimingCapture()
+{
+	capturedTimings.clear();
+	isCapturingTimings = true;
+}
+
+
+
+void ArenaPanel::SaveTimings(const string &path)
+{
+	ostringstream out;
+	out << "frame,engine wait ms,commands ms,step ms,events ms,draw ms,ships,projectiles,visuals\n";
+	for(const FrameTiming &timing : capturedTimings)
+		out << timing.frame << ',' << timing.wait << ',' << timing.commands << ',' << timing.step << ','
+			<< timing.events << ',' << timing.draw << ',' << timing.ships << ',' << timing.projectiles << ','
+			<< timing.visuals << '\n';
+	Files::Write(path, out.str());
+
+	capturedTimings.clear();
+	isCapturingTimings = false;
+}
+
+
+
+bool ArenaPanel::IsCapturingTimings() const
+{
+	return isCapturingTimings;
+}
+
+
+
+size_t ArenaPanel::CapturedTimings() const
+{
+	return capturedTimings.size();
+}
+
+
+
 bool ArenaPanel::AllowsFastForward() const noexcept
 {
 	return true;
@@ -234,6 +506,13 @@ bool ArenaPanel::Click(int x, int y, int clicks)
 
 	engine.Click(dragSource, dragSource, hasShift, false);
 
+	ArenaReplay::Command command;
+	command.type = ArenaReplay::Command::Type::CLICK;
+	command.from = dragSource;
+	command.to = dragSource;
+	command.amount = hasShift;
+	Record(command);
+
 	return true;
 }
 
@@ -241,8 +520,16 @@ bool ArenaPanel::Click(int x, int y, int clicks)
 
 bool ArenaPanel::RClick(int x, int y)
 {
+	if(isReplaying)
+		return true;
+
 	engine.RClick(Point(x, y));
 
+	ArenaReplay::Command command;
+	command.type = ArenaReplay::Command::Type::RCLICK;
+	command.from = Point(x, y);
+	Record(command);
+
 	return true;
 }
 
@@ -267,8 +554,17 @@ bool ArenaPanel::Release(int x, int y)
 	{
 		dragPoint = Point(x, y);
 		if(dragPoint.Distance(dragSource) > 5.)
+		{
 			engine.Click(dragSource, dragPoint, hasShift, false);
 
+			ArenaReplay::Command command;
+			command.type = ArenaReplay::Command::Type::CLICK;
+			command.from = dragSource;
+			command.to = dragPoint;
+			command.amount = hasShift;
+			Record(command);
+		}
+
 		isDragging = false;
 	}
 
@@ -320,3 +616,260 @@ void ArenaPanel::StepEvents(bool &isActive)
 		handledFront = false;
 	}
 }
+
+
+
+void ArenaPanel::PlaceShips(const Ship &ship, const Government &gov, int amount)
+{
+	QueueShips(vector<const Ship *>(amount, &ship), {}, gov);
+}
+
+
+
+void ArenaPanel::PlaceFleets(const Fleet &fleet, const Government &gov, int amount)
+{
+	if(amount <= 0 || fleet.variants.empty())
+		return;
+
+	// Choose the variant of every fleet first, so that the list of ships can be
+	// allocated once.
+	vector<const Variant *> variants;
+	variants.reserve(amount);
+	size_t count = 0;
+	for(int i = 0; i < amount; ++i)
+	{
+		variants.push_back(&fleet.variants.Get());
+		count += variants.back()->ships.size();
+	}
+
+	vector<const Ship *> ships;
+	ships.reserve(count);
+	vector<size_t> groups;
+	groups.reserve(amount);
+	for(const Variant *variant : variants)
+	{
+		for(const Ship *ship : variant->ships)
+			if(ship)
+				ships.push_back(ship);
+		if(ships.size() > (groups.empty() ? 0 : groups.back()))
+			groups.push_back(ships.size());
+	}
+	QueueShips(std::move(ships), std::move(groups), gov);
+}
+
+
+
+void ArenaPanel::QueueShips(vector<const Ship *> ships, vector<size_t> groups, const Government &gov)
+{
+	if(ships.empty())
+		return;
+
+	// The background copies can't read the original ships, because they can be
+	// edited or removed while the copies are made. Instead, every ship type is
+	// copied once here.
+	const System *system = player.GetSystem();
+	auto batch = make_unique<SpawnBatch>();
+	map<const Ship *, shared_ptr<const Ship>> templates;
+	batch->templates.reserve(ships.size());
+	for(const Ship *ship : ships)
+	{
+		auto &copy = templates[ship];
+		if(!copy)
+			copy = ArenaSimulation::CopyShip(*ship, gov, *system);
+		batch->templates.push_back(copy);
+	}
+	batch->ships.resize(batch->templates.size());
+	batch->groups = std::move(groups);
+
+	// Copying a ship copies all of its outfits and attributes, which adds up when
+	// spawning thousands of them, so it is done in the background. A recording
+	// needs the same ships to be placed in the same frame when it is replayed, so
+	// then the ships are copied as they are placed.
+	if(!isRecording && !isReplaying)
+		batch->copies = async(launch::async, [batch = batch.get()]
+			{
+				for(size_t i = 0; i < batch->templates.size() && !batch->cancel; ++i)
+				{
+					batch->ships[i] = make_shared<Ship>(*batch->templates[i]);
+					++batch->copied;
+				}
+			});
+	spawnQueue.push_back(std::move(batch));
+}
+
+
+
+void ArenaPanel::PlaceQueuedShips()
+{
+	// The same number of ships is placed while replaying as while recording, so
+	// this must not depend on how fast the ships are copied.
+	size_t budget = max(1, isRecording || isReplaying ? replay.SpawnRate() : spawnRate);
+	while(budget && !spawnQueue.empty())
+	{
+		SpawnBatch &batch = *spawnQueue.front();
+		// Only the ships that were already copied in the background are placed.
+		const size_t ready = batch.copies.valid() ? batch.copied.load() : batch.ships.size();
+		const size_t begin = batch.placed;
+		size_t end = min({batch.ships.size(), begin + budget, ready});
+		if(!batch.groups.empty())
+		{
+			// Only whole groups are placed, but at least one every frame even if it
+			// is larger than the budget.
+			end = begin;
+			while(batch.nextGroup < batch.groups.size() && batch.groups[batch.nextGroup] <= ready
+					&& (end == begin || batch.groups[batch.nextGroup] - begin <= budget))
+				end = batch.groups[batch.nextGroup++];
+		}
+		if(end == begin)
+			break;
+
+		// Fleet::Place uses the random number generator, so the ships are placed on
+		// this thread and in order.
+		const System &system = *player.GetSystem();
+		size_t groupEnd = begin;
+		auto group = batch.groups.begin();
+		shared_ptr<Ship> leader;
+		for( ; batch.placed < end; ++batch.placed)
+		{
+			shared_ptr<Ship> &ship = batch.ships[batch.placed];
+			if(!ship)
+				ship = make_shared<Ship>(*batch.templates[batch.placed]);
+			if(batch.placed == groupEnd)
+			{
+				// The first ship of a group enters like a ship without a group.
+				Fleet::Place(system, *ship);
+				leader = ship;
+				if(!batch.groups.empty())
+				{
+					group = upper_bound(group, batch.groups.end(), batch.placed);
+					groupEnd = *group;
+				}
+				else
+					groupEnd = batch.placed + 1;
+			}
+			else
+				ship->Place(leader->Position() + Angle::Random().Unit() * (Random::Real() * FORMATION_RADIUS),
+					leader->Velocity(), leader->Facing());
+			engine.Place(std::move(ship));
+		}
+		budget -= min(budget, end - begin);
+
+		if(batch.placed == batch.ships.size())
+			spawnQueue.pop_front();
+	}
+}
+
+
+
+void ArenaPanel::Restart(uint64_t seed, const System *system)
+{
+	engine.ships.clear();
+	spawnQueue.clear();
+	eventQueue.clear();
+	handledFront = false;
+	Random::Seed(seed);
+	frame = 0;
+	replayIndex = 0;
+
+	player.SetSystem(*system);
+	const_cast<System *>(system)->SetDate(currentDate);
+	engine.EnterSystem(system);
+}
+
+
+
+void ArenaPanel::Record(const ArenaReplay::Command &command)
+{
+	if(!isRecording)
+		return;
+
+	ArenaReplay::Command recorded = command;
+	recorded.frame = frame;
+	replay.Add(recorded);
+}
+
+
+
+void ArenaPanel::RunReplay()
+{
+	const auto &commands = replay.Commands();
+	for( ; replayIndex < commands.size() && commands[replayIndex].frame <= frame; ++replayIndex)
+	{
+		const ArenaReplay::Command &command = commands[replayIndex];
+		const Government *gov = editor.Universe().governments.Find(command.government);
+		switch(command.type)
+		{
+		case ArenaReplay::Command::Type::SHIPS:
+			if(const Ship *ship = editor.Universe().ships.Find(command.name); ship && gov)
+				PlaceShips(*ship, *gov, command.amount);
+			break;
+		case ArenaReplay::Command::Type::FLEETS:
+			if(const Fleet *fleet = editor.Universe().fleets.Find(command.name); fleet && gov)
+				PlaceFleets(*fleet, *gov, command.amount);
+			break;
+		case ArenaReplay::Command::Type::CLEAR:
+			engine.ships.clear();
+			spawnQueue.clear();
+			break;
+		case ArenaReplay::Command::Type::CLICK:
+			engine.Click(command.from, command.to, command.amount, false);
+			break;
+		case ArenaReplay::Command::Type::RCLICK:
+			engine.RClick(command.from);
+			break;
+		}
+	}
+}
+
+
+
+void ArenaPanel::AddTiming(const FrameTiming &timing)
+{
+	recentTimings.push_back(timing);
+	if(recentTimings.size() > TIMING_FRAMES)
+		recentTimings.pop_front();
+	if(isCapturingTimings)
+		capturedTimings.push_back(timing);
+}
+
+
+
+void ArenaPanel::DrawTimings() const
+{
+	if(recentTimings.empty())
+		return;
+
+	const Font &font = FontSet::Get(14);
+	const Color &color = *GameData::Colors().Get("medium");
+	Point pos(Screen::Left() + 10., Screen::Top() + 10.);
+	auto draw = [&font, &color, &pos](const string &text)
+	{
+		font.Draw(text, pos, color);
+		pos.Y() += 20.;
+	};
+
+	// Show the average and the worst time of each part of the frame.
+	auto line = [this, &draw](const string &name, double FrameTiming::*part)
+	{
+		double sum = 0.;
+		double worst = 0.;
+		for(const FrameTiming &timing : recentTimings)
+		{
+			sum += timing.*part;
+			worst = max(worst, timing.*part);
+		}
+		ostringstream out;
+		out << fixed << setprecision(2) << name << ": " << sum / recentTimings.size() << " ms (max " << worst << ")";
+		draw(out.str());
+	};
+	line("engine wait", &FrameTiming::wait);
+	line("commands", &FrameTiming::commands);
+	line("engine step (draw lists)", &FrameTiming::step);
+	line("events", &FrameTiming::events);
+	line("draw", &FrameTiming::draw);
+
+	const FrameTiming &last = recentTimings.back();
+	draw("ships: " + to_string(last.ships));
+	draw("projectiles: " + to_string(last.projectiles));
+	draw("visuals: " + to_string(last.visuals));
+}
@@ -5,15 +5,27 @@
 
 #include "Panel.h"
 
+#include "ArenaReplay.h"
 #include "Command.h"
 #include "Engine.h"
 #include "PlayerInfo.h"
 #include "ShipEvent.h"
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
 #include <functional>
+#include <future>
 #include <list>
+#include <memory>
+#include <string>
+#include <vector>
 
 class Editor;
+class Fleet;
+class Government;
+class Ship;
 class SystemEditor;
 
 
@@ -32,6 +44,32 @@ public:
 	static inline bool highlightFlagship = false;
 	static inline bool showStatusOverlays = false;
 	static inline bool showChat = false;
+	// The number of frames a replay advances every frame.
+	static inline int replaySpeed = 1;
+	static inline bool showTimings = false;
+	// The maximum number of spawned ships that are placed into the arena every
+	// frame, so that large spawns ramp up instead of stalling the game.
+	static inline int spawnRate = 100;
+
+
+	// The time spent on each part of a frame in milliseconds, and the number of
+	// objects in the arena at the end of it.
+	struct FrameTiming {
+		int frame = 0;
+		// Waiting for the engine to finish the frame it calculates in the
+		// background. The calculation overlaps with drawing, so this is only the
+		// part of it that took longer than the rest of the frame.
+		double wait = 0.;
+		// Running the queued commands and the commands of a replay.
+		double commands = 0.;
+		// Engine::Step, which builds the draw lists from the calculated frame.
+		double step = 0.;
+		double events = 0.;
+		double draw = 0.;
+		std::size_t ships = 0;
+		std::size_t projectiles = 0;
+		std::size_t visuals = 0;
+	};
 
 
 public:
@@ -43,6 +81,39 @@ public:
 	void SetSystem(const System *system);
 	void Execute(std::function<void()> f);
 
+	// Functions for changing the ships in the arena. These are recorded if a
+	// recording is running, and ignored while a replay is running.
+	void SpawnShips(const Ship &ship, const Government &gov, int amount);
+	void SpawnFleets(const Fleet &fleet, const Government &gov, int amount);
+	void ClearShips();
+	// The number of spawned ships that weren't placed into the arena yet.
+	std::size_t QueuedShips() const;
+
+	// Clears the arena and starts recording everything that happens in it, with
+	// the random number generator seeded with the given seed.
+	void StartRecording(uint64_t seed);
+	// Stops the recording and saves it to the given file.
+	void SaveRecording(const std::string &path);
+	// Clears the arena and runs the battle in the given replay file again. Returns
+	// false if the file isn't a valid replay.
+	bool StartReplay(const std::string &path);
+	void StopReplay();
+	bool IsRecording() const;
+	bool IsReplaying() const;
+	// The number of frames since the recording or replay started.
+	int Frame() const;
+	// The number of frames of the replay that is running.
+	int ReplayFrames() const;
+	// Advances the arena by a single frame while it is paused.
+	void StepFrame();
+
+	// Starts keeping the timings of every frame, so that they can be saved later.
+	void StartTimingCapture();
+	// Saves the captured timings as a CSV file, and stops capturing them.
+	void SaveTimings(const std::string &path);
+	bool IsCapturingTimings() const;
+	std::size_t CapturedTimings() const;
+
 	// The main panel allows fast-forward.
 	bool AllowsFastForward() const noexcept final;
 
@@ -61,6 +132,24 @@ protected:
 private:
 	void StepEvents(bool &isActive);
 
+	void PlaceShips(const Ship &ship, const Government &gov, int amount);
+	void PlaceFleets(const Fleet &fleet, const Government &gov, int amount);
+	// Starts copying the given ships in the background, or while placing them if
+	// the arena is recording or replaying. They are placed into the arena a few at
+	// a time by PlaceQueuedShips. Each group ends at the given index
+	// and is placed together, in formation around its first ship. Without groups,
+	// every ship is placed on its own.
+	void QueueShips(std::vector<const Ship *> ships, std::vector<std::size_t> groups, const Government &gov);
+	void PlaceQueuedShips();
+	// Removes every ship and reseeds the random number generator of this thread,
+	// so that the ships of the battle that follows are placed the same way.
+	void Restart(uint64_t seed, const System *system);
+	void Record(const ArenaReplay::Command &command);
+	// Runs the commands of the replay that were given in the current frame.
+	void RunReplay();
+	void AddTiming(const FrameTiming &timing);
+	void DrawTimings() const;
+
 
 private:
 	friend class ArenaControl;
@@ -76,6 +165,37 @@ private:
 
 	Point center;
 	bool paused = false;
+	// Whether a single frame should be run while paused.
+	bool stepFrame = false;
+
+	// Ships that are being copied in the background, to be placed into the arena.
+	struct SpawnBatch {
+		// Tells the copies to stop, so that removing the batch doesn't wait for them.
+		~SpawnBatch() { cancel = true; }
+
+		// The ships to spawn are copied from these, which belong to the batch, so
+		// that the editor can change the original ships in the meantime.
+		std::vector<std::shared_ptr<const Ship>> templates;
+		std::vector<std::shared_ptr<Ship>> ships;
+		std::vector<std::size_t> groups;
+		std::size_t nextGroup = 0;
+		// The number of ships that were copied so far, and placed so far.
+		std::atomic<std::size_t> copied = 0;
+		std::size_t placed = 0;
+		std::atomic<bool> cancel = false;
+		// This is destroyed first, which waits for the copies to finish. It isn't
+		// valid if the ships are copied while placing them.
+		std::future<void> copies;
+	};
+	std::deque<std::unique_ptr<SpawnBatch>> spawnQueue;
+
+	// The battle that is being recorded or replayed.
+	ArenaReplay replay;
+	bool isRecording = false;
+	bool isReplaying = false;
+	// The next command of the replay to run.
+	std::size_t replayIndex = 0;
+	int frame = 0;
 
 	// These are the pending ShipEvents that have yet to be processed.
 	std::list<ShipEvent> eventQueue;
@@ -83,6 +203,11 @@ private:
 
 	Command show;
 
+	// The timings of the last second, for the overlay.
+	std::deque<FrameTiming> recentTimings;
+	std::vector<FrameTiming> capturedTimings;
+	bool isCapturingTimings = false;
+
 	// For displaying the GPU load.
 	double load = 0.;
 	double loadSum = 0.;
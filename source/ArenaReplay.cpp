@@ -0,0 +1,201 @@
+// SPDX-License-Identifier: GPL-3.0
+
+#include "ArenaReplay.h"
+
+#include "DataFile.h"
+#include "DataNode.h"
+#include "DataWriter.h"
+#include "Files.h"
+
+#include <algorithm>
+#include <charconv>
+#include <system_error>
+
+using namespace std;
+
+namespace {
+	const char *const TYPE_NAMES[] = {"ships", "fleets", "clear", "click", "rclick"};
+}
+
+
+
+bool ArenaReplay::Load(const string &path)
+{
+	DataFile file(path);
+	for(const DataNode &node : file)
+	{
+		if(node.Token(0) != "replay")
+			continue;
+
+		Clear(0, "");
+		for(const DataNode &child : node)
+		{
+			const string &key = child.Token(0);
+			if(key == "seed" && child.Size() >= 2)
+			{
+				// The seed is saved as text, because it may not fit into a double.
+				const string &token = child.Token(1);
+				const auto result = from_chars(token.data(), token.data() + token.size(), seed);
+				if(result.ec != errc() || result.ptr != token.data() + token.size())
+				{
+					child.PrintTrace("Error: Invalid seed:");
+					return false;
+				}
+			}
+			else if(key == "system" && child.Size() >= 2)
+				system = child.Token(1);
+			else if(key == "frames" && child.Size() >= 2)
+				frames = child.Value(1);
+			else if(key == "spawn rate" && child.Size() >= 2)
+				spawnRate = max(1, static_cast<int>(child.Value(1)));
+			else if(child.IsNumber(0) && child.Size() >= 2)
+			{
+				auto it = find(begin(TYPE_NAMES), end(TYPE_NAMES), child.Token(1));
+				if(it == end(TYPE_NAMES))
+				{
+					child.PrintTrace("Skipping unrecognized command:");
+					continue;
+				}
+
+				Command command;
+				command.frame = child.Value(0);
+				command.type = static_cast<Command::Type>(it - begin(TYPE_NAMES));
+				if((command.type == Command::Type::SHIPS || command.type == Command::Type::FLEETS)
+						&& child.Size() >= 5)
+				{
+					command.name = child.Token(2);
+					command.government = child.Token(3);
+					command.amount = child.Value(4);
+				}
+				else if(command.type == Command::Type::CLICK && child.Size() >= 7)
+				{
+					command.from = Point(child.Value(2), child.Value(3));
+					command.to = Point(child.Value(4), child.Value(5));
+					command.amount = child.Value(6);
+				}
+				else if(command.type == Command::Type::RCLICK && child.Size() >= 4)
+					command.from = Point(child.Value(2), child.Value(3));
+				else if(command.type != Command::Type::CLEAR)
+				{
+					child.PrintTrace("Skipping incomplete command:");
+					continue;
+				}
+				Add(command);
+			}
+			else
+				child.PrintTrace("Skipping unrecognized attribute:");
+		}
+		return !system.empty();
+	}
+	return false;
+}
+
+
+
+void ArenaReplay::Save(const string &path) const
+{
+	DataWriter writer;
+	writer.Write("replay");
+	writer.BeginChild();
+	{
+		writer.Write("seed", to_string(seed));
+		writer.Write("system", system);
+		writer.Write("frames", frames);
+		writer.Write("spawn rate", spawnRate);
+		for(const Command &command : commands)
+		{
+			const char *type = TYPE_NAMES[static_cast<int>(command.type)];
+			switch(command.type)
+			{
+			case Command::Type::SHIPS:
+			case Command::Type::FLEETS:
+				writer.Write(command.frame, type, command.name, command.government, command.amount);
+				break;
+			case Command::Type::CLEAR:
+				writer.Write(command.frame, type);
+				break;
+			case Command::Type::CLICK:
+				writer.Write(command.frame, type, command.from.X(), command.from.Y(),
+					command.to.X(), command.to.Y(), command.amount);
+				break;
+			case Command::Type::RCLICK:
+				writer.Write(command.frame, type, command.from.X(), command.from.Y());
+				break;
+			}
+		}
+	}
+	writer.EndChild();
+
+	Files::Write(path, writer.SaveToString());
+}
+
+
+
+void ArenaReplay::Clear(uint64_t seed, const string &system, int frames)
+{
+	this->seed = seed;
+	this->system = system;
+	this->frames = frames;
+	spawnRate = 100;
+	commands.clear();
+}
+
+
+
+void ArenaReplay::Add(const Command &command)
+{
+	// Commands are usually added in order, but keep them sorted in case a file
+	// was edited by hand.
+	auto it = upper_bound(commands.begin(), commands.end(), command.frame,
+		[](int frame, const Command &other) { return frame < other.frame; });
+	commands.insert(it, command);
+}
+
+
+
+void ArenaReplay::SetFrames(int frames)
+{
+	this->frames = frames;
+}
+
+
+
+void ArenaReplay::SetSpawnRate(int spawnRate)
+{
+	this->spawnRate = max(1, spawnRate);
+}
+
+
+
+uint64_t ArenaReplay::Seed() const
+{
+	return seed;
+}
+
+
+
+const string &ArenaReplay::SystemName() const
+{
+	return system;
+}
+
+
+
+int ArenaReplay::Frames() const
+{
+	return frames;
+}
+
+
+
+int ArenaReplay::SpawnRate() const
+{
+	return spawnRate;
+}
+
+
+
+const vector<ArenaReplay::Command> &ArenaReplay::Commands() const
+{
+	return commands;
+}
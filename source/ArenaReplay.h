@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: GPL-3.0
+
+#ifndef ARENA_REPLAY_H_
+#define ARENA_REPLAY_H_
+
+#include "Point.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+
+// Class that stores everything that was done in the arena, and the frame it was
+// done in, so that a battle can be run again. The seed decides everything that is
+// random on the arena's own thread, like the fleet variants and where the ships
+// are placed. The AI runs on the engine's thread, which isn't seeded, so a replay
+// gives the same commands at the same frames, but the battle can still play out
+// differently.
+class ArenaReplay {
+public:
+	struct Command {
+		enum class Type {
+			// Spawning "amount" ships or fleets named "name" for "government".
+			SHIPS,
+			FLEETS,
+			CLEAR,
+			// A click on or drag from "from" to "to". The amount is 1 if shift was held.
+			CLICK,
+			RCLICK
+		};
+
+		int frame = 0;
+		Type type = Type::CLEAR;
+		std::string name;
+		std::string government;
+		int amount = 0;
+		Point from;
+		Point to;
+	};
+
+
+public:
+	// Loads a replay from the given file. Returns false if it is not a replay.
+	bool Load(const std::string &path);
+	void Save(const std::string &path) const;
+
+	// Forgets every command and starts a new battle.
+	void Clear(uint64_t seed, const std::string &system, int frames = 0);
+	void Add(const Command &command);
+	// Sets the number of frames the battle lasted.
+	void SetFrames(int frames);
+	// Sets the number of spawned ships that were placed into the arena every frame.
+	void SetSpawnRate(int spawnRate);
+
+	uint64_t Seed() const;
+	const std::string &SystemName() const;
+	int Frames() const;
+	int SpawnRate() const;
+	// The commands, sorted by the frame they were given in.
+	const std::vector<Command> &Commands() const;
+
+
+private:
+	uint64_t seed = 0;
+	std::string system;
+	int frames = 0;
+	// Replays that were recorded before the spawn rate could be changed used 100.
+	int spawnRate = 100;
+	std::vector<Command> commands;
+};
+
+
+
+#endif
@@ -0,0 +1,516 @@
+// SPDX-License-Identifier: GPL-3.0
+
+#include "ArenaSimulation.h"
+
+#include "DataFile.h"
+#include "DataNode.h"
+#include "Engine.h"
+#include "Fleet.h"
+#include "GameData.h"
+#include "Government.h"
+#include "Personality.h"
+#include "PlayerInfo.h"
+#include "Random.h"
+#include "Ship.h"
+#include "System.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+using namespace std;
+
+namespace {
+	// The number of frames in a second of game time.
+	constexpr double FRAMES_PER_SECOND = 60.;
+
+	// Loads every valid arena simulation in the given file.
+	vector<ArenaSimulation> LoadSimulations(const string &path, int &exitCode)
+	{
+		vector<ArenaSimulation> simulations;
+		DataFile file(path);
+		for(const DataNode &node : file)
+		{
+			if(node.Token(0) != "arena")
+			{
+				node.PrintTrace("Skipping unrecognized root object:");
+				continue;
+			}
+
+			ArenaSimulation simulation(node);
+			if(!simulation.IsValid())
+			{
+				node.PrintTrace("Error: An arena needs a system and at least two sides with ships:");
+				exitCode = 1;
+				continue;
+			}
+			simulations.push_back(std::move(simulation));
+		}
+		return simulations;
+	}
+
+	// Starts the given command, whose standard output can then be read from the
+	// returned stream. Its errors are discarded, since every worker would print
+	// the same ones.
+	FILE *StartProcess(const string &command)
+	{
+#ifdef _WIN32
+		// cmd.exe removes the outermost quotes of the command it runs.
+		return _popen(("\"" + command + " 2>NUL\"").c_str(), "r");
+#else
+		return popen((command + " 2>/dev/null").c_str(), "r");
+#endif
+	}
+
+	// Waits for the given process to exit. Returns true if it succeeded.
+	bool FinishProcess(FILE *process)
+	{
+#ifdef _WIN32
+		return !_pclose(process);
+#else
+		return !pclose(process);
+#endif
+	}
+}
+
+
+
+void ArenaSimulation::Summary::Add(const Result &result)
+{
+	++runs;
+	if(result.winner < 0)
+		++draws;
+	else
+	{
+		if(wins.size() <= static_cast<size_t>(result.winner))
+		{
+			wins.resize(result.winner + 1);
+			winFrames.resize(result.winner + 1);
+		}
+		++wins[result.winner];
+		winFrames[result.winner] += result.frames;
+	}
+}
+
+
+
+void ArenaSimulation::Summary::Add(const Summary &other)
+{
+	runs += other.runs;
+	draws += other.draws;
+	if(wins.size() < other.wins.size())
+	{
+		wins.resize(other.wins.size());
+		winFrames.resize(other.wins.size());
+	}
+	for(size_t i = 0; i < other.wins.size(); ++i)
+	{
+		wins[i] += other.wins[i];
+		winFrames[i] += other.winFrames[i];
+	}
+}
+
+
+
+void ArenaSimulation::Summary::Write(ostream &out) const
+{
+	out << "summary " << runs << ' ' << draws << ' ' << wins.size();
+	// The frames are whole numbers, so they can be written without a fraction.
+	for(size_t i = 0; i < wins.size(); ++i)
+		out << ' ' << wins[i] << ' ' << static_cast<int64_t>(winFrames[i]);
+	out << endl;
+}
+
+
+
+bool ArenaSimulation::Summary::Read(const string &line)
+{
+	istringstream in(line);
+	string tag;
+	size_t sides = 0;
+	if(!(in >> tag >> runs >> draws >> sides) || tag != "summary")
+		return false;
+
+	wins.assign(sides, 0);
+	winFrames.assign(sides, 0.);
+	for(size_t i = 0; i < sides; ++i)
+		if(!(in >> wins[i] >> winFrames[i]))
+			return false;
+	return true;
+}
+
+
+
+ArenaSimulation::ArenaSimulation(const DataNode &node)
+{
+	Load(node);
+}
+
+
+
+void ArenaSimulation::Load(const DataNode &node)
+{
+	if(node.Size() >= 2)
+		name = node.Token(1);
+
+	for(const DataNode &child : node)
+	{
+		const string &key = child.Token(0);
+		if(key == "system" && child.Size() >= 2)
+		{
+			system = GameData::Systems().Find(child.Token(1));
+			if(!system)
+				child.PrintTrace("Error: Unknown system:");
+		}
+		else if(key == "frames" && child.Size() >= 2)
+			frames = max(1, static_cast<int>(child.Value(1)));
+		else if(key == "runs" && child.Size() >= 2)
+			runs = max(1, static_cast<int>(child.Value(1)));
+		else if(key == "seed" && child.Size() >= 2)
+			seed = child.Value(1);
+		else if(key == "side" && child.Size() >= 2)
+		{
+			Side &side = sides.emplace_back();
+			side.government = GameData::Governments().Find(child.Token(1));
+			if(!side.government)
+				child.PrintTrace("Error: Unknown government:");
+
+			for(const DataNode &grand : child)
+			{
+				const string &type = grand.Token(0);
+				const int count = grand.Size() >= 3 ? max(1, static_cast<int>(grand.Value(2))) : 1;
+				if(type == "ship" && grand.Size() >= 2)
+				{
+					const Ship *ship = GameData::Ships().Find(grand.Token(1));
+					if(ship)
+						side.ships.emplace_back(ship, count);
+					else
+						grand.PrintTrace("Error: Unknown ship:");
+				}
+				else if(type == "fleet" && grand.Size() >= 2)
+				{
+					const Fleet *fleet = GameData::Fleets().Find(grand.Token(1));
+					if(fleet)
+						side.fleets.emplace_back(fleet, count);
+					else
+						grand.PrintTrace("Error: Unknown fleet:");
+				}
+				else
+					grand.PrintTrace("Skipping unrecognized attribute:");
+			}
+		}
+		else
+			child.PrintTrace("Skipping unrecognized attribute:");
+	}
+}
+
+
+
+bool ArenaSimulation::IsValid() const
+{
+	if(!system || sides.size() < 2)
+		return false;
+	return all_of(sides.begin(), sides.end(), [](const Side &side)
+		{
+			return side.government && (!side.ships.empty() || !side.fleets.empty());
+		});
+}
+
+
+
+void ArenaSimulation::SetSystem(const System *system)
+{
+	this->system = system;
+}
+
+
+
+void ArenaSimulation::SetFrames(int frames)
+{
+	this->frames = max(1, frames);
+}
+
+
+
+void ArenaSimulation::SetRuns(int runs)
+{
+	this->runs = max(1, runs);
+}
+
+
+
+void ArenaSimulation::AddShips(const Government *government, const Ship *ship, int count)
+{
+	if(count > 0)
+		SideOf(government).ships.emplace_back(ship, count);
+}
+
+
+
+void ArenaSimulation::AddFleets(const Government *government, const Fleet *fleet, int count)
+{
+	if(count > 0)
+		SideOf(government).fleets.emplace_back(fleet, count);
+}
+
+
+
+const string &ArenaSimulation::Name() const
+{
+	return name;
+}
+
+
+
+int ArenaSimulation::Runs() const
+{
+	return runs;
+}
+
+
+
+vector<const Government *> ArenaSimulation::Governments() const
+{
+	vector<const Government *> governments;
+	for(const Side &side : sides)
+		governments.push_back(side.government);
+	return governments;
+}
+
+
+
+ArenaSimulation::Result ArenaSimulation::Run(int run) const
+{
+	Battle battle(*this, run);
+	while(!battle.Step(frames))
+		continue;
+	return battle.GetResult();
+}
+
+
+
+ArenaSimulation::Summary ArenaSimulation::RunAll(int worker, int workers) const
+{
+	Summary summary;
+	summary.wins.resize(sides.size());
+	summary.winFrames.resize(sides.size());
+	for(int run = worker; run < runs; run += workers)
+		summary.Add(Run(run));
+	return summary;
+}
+
+
+
+void ArenaSimulation::Print(const Summary &summary, ostream &out) const
+{
+	out << "arena \"" << name << "\": " << summary.runs << " runs in " << system->Name() << endl;
+	out << left << setw(30) << "side" << right << setw(8) << "wins" << setw(10) << "win rate"
+		<< setw(18) << "time to kill (s)" << endl;
+
+	const double runs = max(1, summary.runs);
+	out << fixed << setprecision(1);
+	for(size_t i = 0; i < sides.size(); ++i)
+	{
+		const int wins = i < summary.wins.size() ? summary.wins[i] : 0;
+		out << left << setw(30) << sides[i].government->TrueName() << right << setw(8) << wins
+			<< setw(9) << 100. * wins / runs << '%';
+		if(wins)
+			out << setw(18) << summary.winFrames[i] / wins / FRAMES_PER_SECOND;
+		out << endl;
+	}
+	out << left << setw(30) << "(draw)" << right << setw(8) << summary.draws
+		<< setw(9) << 100. * summary.draws / runs << '%' << endl;
+	out << defaultfloat;
+}
+
+
+
+shared_ptr<Ship> ArenaSimulation::CopyShip(const Ship &ship, const Government &gov, const System &system)
+{
+	auto newShip = make_shared<Ship>(ship);
+	newShip->SetName(ship.TrueName());
+	newShip->SetSystem(&system);
+	newShip->SetGovernment(&gov);
+	newShip->SetPersonality(Personality::STAYING | Personality::UNINTERESTED);
+	return newShip;
+}
+
+
+
+shared_ptr<Ship> ArenaSimulation::MakeShip(const Ship &ship, const Government &gov, const System &system)
+{
+	auto newShip = CopyShip(ship, gov, system);
+	Fleet::Place(system, *newShip);
+	return newShip;
+}
+
+
+
+ArenaSimulation::Battle::Battle(const ArenaSimulation &simulation, int run)
+	: maxFrames(simulation.frames), player(make_unique<PlayerInfo>()),
+	ships(simulation.sides.size())
+{
+	Random::Seed(simulation.seed + run);
+
+	const System *system = simulation.system;
+	player->SetSystem(*system);
+	engine = make_unique<Engine>(*player);
+	engine->EnterSystem(system);
+
+	for(size_t i = 0; i < simulation.sides.size(); ++i)
+	{
+		const Side &side = simulation.sides[i];
+		for(const auto &it : side.ships)
+			for(int j = 0; j < it.second; ++j)
+				ships[i].push_back(MakeShip(*it.first, *side.government, *system));
+		for(const auto &it : side.fleets)
+			for(int j = 0; j < it.second; ++j)
+				for(const auto &ship : it.first->variants.Get().Ships())
+					ships[i].push_back(MakeShip(*ship, *side.government, *system));
+
+		for(const auto &ship : ships[i])
+			engine->Place(ship);
+	}
+}
+
+
+
+ArenaSimulation::Battle::~Battle() = default;
+
+
+
+bool ArenaSimulation::Battle::Step(int frames)
+{
+	for(int i = 0; i < frames && !isOver; ++i)
+	{
+		engine->Step(true);
+		// Nothing handles the events of the battle.
+		engine->Events().clear();
+		engine->Go();
+		engine->Wait();
+		++result.frames;
+
+		// A side is out of the fight once all of its ships are destroyed or disabled.
+		int sidesLeft = 0;
+		int lastSide = -1;
+		for(size_t j = 0; j < ships.size(); ++j)
+			if(any_of(ships[j].begin(), ships[j].end(), [](const shared_ptr<Ship> &ship)
+					{ return !ship->IsDestroyed() && !ship->IsDisabled(); }))
+			{
+				++sidesLeft;
+				lastSide = j;
+			}
+		if(sidesLeft <= 1)
+		{
+			result.winner = lastSide;
+			isOver = true;
+		}
+		else if(result.frames >= maxFrames)
+			isOver = true;
+	}
+	return isOver;
+}
+
+
+
+const ArenaSimulation::Result &ArenaSimulation::Battle::GetResult() const
+{
+	return result;
+}
+
+
+
+ArenaSimulation::Side &ArenaSimulation::SideOf(const Government *government)
+{
+	auto it = find_if(sides.begin(), sides.end(), [government](const Side &side)
+		{
+			return side.government == government;
+		});
+	if(it != sides.end())
+		return *it;
+
+	Side &side = sides.emplace_back();
+	side.government = government;
+	return side;
+}
+
+
+
+int ArenaSimulation::RunFile(const string &path, const string &program)
+{
+	int exitCode = 0;
+	const vector<ArenaSimulation> simulations = LoadSimulations(path, exitCode);
+
+	// There is no point in starting more workers than there are runs.
+	int maxRuns = 0;
+	for(const ArenaSimulation &simulation : simulations)
+		maxRuns = max(maxRuns, simulation.Runs());
+	const int workers = min(maxRuns, static_cast<int>(max(1u, thread::hardware_concurrency())));
+
+	vector<Summary> summaries;
+	if(workers <= 1)
+		for(const ArenaSimulation &simulation : simulations)
+			summaries.push_back(simulation.RunAll());
+	else
+	{
+		// Every worker loads the game data by itself, so they are all started before
+		// reading the results of any of them.
+		vector<FILE *> processes;
+		for(int i = 0; i < workers; ++i)
+		{
+			const string command = "\"" + program + "\" --arena \"" + path + "\" --arena-worker "
+				+ to_string(i) + ' ' + to_string(workers);
+			FILE *process = StartProcess(command);
+			if(process)
+				processes.push_back(process);
+		}
+
+		// Each worker writes a summary of its runs of every simulation, in order.
+		bool failed = static_cast<int>(processes.size()) != workers;
+		summaries.resize(simulations.size());
+		for(FILE *process : processes)
+		{
+			size_t count = 0;
+			string line;
+			char buffer[256];
+			while(fgets(buffer, sizeof(buffer), process))
+			{
+				line += buffer;
+				if(line.back() != '\n')
+					continue;
+
+				Summary summary;
+				if(summary.Read(line) && count < summaries.size())
+					summaries[count++].Add(summary);
+				line.clear();
+			}
+			failed |= !FinishProcess(process) || count != summaries.size();
+		}
+		if(failed)
+		{
+			cerr << "Error: Unable to run the arena battles in separate processes." << endl;
+			return 1;
+		}
+	}
+
+	for(size_t i = 0; i < simulations.size(); ++i)
+	{
+		simulations[i].Print(summaries[i], cout);
+		cout << endl;
+	}
+	return exitCode;
+}
+
+
+
+int ArenaSimulation::RunWorker(const string &path, int worker, int workers)
+{
+	// The process that started this worker reports the invalid simulations.
+	int exitCode = 0;
+	for(const ArenaSimulation &simulation : LoadSimulations(path, exitCode))
+		simulation.RunAll(worker, workers).Write(cout);
+	return 0;
+}
@@ -0,0 +1,169 @@
+// SPDX-License-Identifier: GPL-3.0
+
+#ifndef ARENA_SIMULATION_H_
+#define ARENA_SIMULATION_H_
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+class DataNode;
+class Engine;
+class Fleet;
+class Government;
+class PlayerInfo;
+class Ship;
+class System;
+
+
+
+// Class representing a battle between two or more sides, which is run without
+// drawing it and as fast as the CPU allows. The same battle is usually run many
+// times, to find out how often each side wins and how long it takes them. It is
+// defined in a data file like this:
+//
+// arena "Cruisers vs Marauders"
+// 	system "Sol"
+// 	frames 18000
+// 	runs 100
+// 	seed 1
+// 	side "Republic"
+// 		ship "Cruiser" 2
+// 	side "Pirate"
+// 		ship "Marauder Falcon (Heavy)" 3
+// 		fleet "Small Northern Pirates"
+class ArenaSimulation {
+public:
+	// The outcome of a single battle.
+	struct Result {
+		// The index of the side that won, or -1 if the battle ran out of time
+		// before only one side was left.
+		int winner = -1;
+		// The number of frames the battle took.
+		int frames = 0;
+	};
+
+	// The outcome of many runs of the same battle.
+	struct Summary {
+		void Add(const Result &result);
+		// Adds the runs of another summary of the same battle.
+		void Add(const Summary &other);
+
+		// Writes the summary as a single line, which Read turns back into a summary.
+		void Write(std::ostream &out) const;
+		bool Read(const std::string &line);
+
+		int runs = 0;
+		int draws = 0;
+		// The number of wins of each side, and the total number of frames these
+		// wins took.
+		std::vector<int> wins;
+		std::vector<double> winFrames;
+	};
+
+	// A single battle, which can be run a few frames at a time. The ships are
+	// copied when the battle starts, but the engine reads the game's global state
+	// (like the attitudes of the governments), so only one battle can run at a
+	// time, and not while the arena is calculating a frame.
+	class Battle {
+	public:
+		// Places the ships of the given run of the simulation.
+		Battle(const ArenaSimulation &simulation, int run);
+		~Battle();
+
+		// Runs at most the given number of frames. Returns true once the battle is over.
+		bool Step(int frames);
+		const Result &GetResult() const;
+
+
+	private:
+		int maxFrames = 0;
+		std::unique_ptr<PlayerInfo> player;
+		std::unique_ptr<Engine> engine;
+		// Keep a reference to every ship, so that they can be checked even after the
+		// engine removed them.
+		std::vector<std::vector<std::shared_ptr<Ship>>> ships;
+		Result result;
+		bool isOver = false;
+	};
+
+
+public:
+	ArenaSimulation() = default;
+	explicit ArenaSimulation(const DataNode &node);
+
+	void Load(const DataNode &node);
+	// Whether this simulation has a system and at least two sides to fight.
+	bool IsValid() const;
+
+	// Functions for setting up a simulation without a data file. Ships and fleets
+	// of the same government fight on the same side.
+	void SetSystem(const System *system);
+	void SetFrames(int frames);
+	void SetRuns(int runs);
+	void AddShips(const Government *government, const Ship *ship, int count);
+	void AddFleets(const Government *government, const Fleet *fleet, int count);
+
+	const std::string &Name() const;
+	int Runs() const;
+	// The government of each side.
+	std::vector<const Government *> Governments() const;
+
+	// Runs the given run of the battle. Each run is seeded with its own number,
+	// which decides the fleet variants and where the ships start. The AI runs on
+	// the engine's own thread, which isn't seeded, so runs with the same seed can
+	// still end differently.
+	Result Run(int run) const;
+	// Runs the battle as many times as requested, one after another. If given a
+	// number of workers, only the runs of the given worker are run.
+	Summary RunAll(int worker = 0, int workers = 1) const;
+	// Writes the win rate and time to kill of each side to the given stream.
+	void Print(const Summary &summary, std::ostream &out) const;
+
+	// Creates a copy of the given ship that fights for the given government in
+	// the given system, like the ships spawned in the arena. The copy isn't given a
+	// position yet, so it can be copied again to spawn many ships of the same type.
+	static std::shared_ptr<Ship> CopyShip(const Ship &ship, const Government &gov, const System &system);
+	// Creates a copy of the given ship and places it into the system.
+	static std::shared_ptr<Ship> MakeShip(const Ship &ship, const Government &gov, const System &system);
+
+	// Runs every arena simulation in the given file and prints their results.
+	// The engine can only run one battle at a time, so the runs are split among
+	// copies of the given program, one for each core. Returns the exit code of
+	// the program.
+	static int RunFile(const std::string &path, const std::string &program);
+	// Runs the given worker's share of the runs of every arena simulation in the
+	// given file, and writes their summaries to the standard output.
+	static int RunWorker(const std::string &path, int worker, int workers);
+
+
+private:
+	// The ships of one side of the battle.
+	struct Side {
+		const Government *government = nullptr;
+		std::vector<std::pair<const Ship *, int>> ships;
+		std::vector<std::pair<const Fleet *, int>> fleets;
+	};
+
+
+private:
+	Side &SideOf(const Government *government);
+
+
+private:
+	std::string name;
+	const System *system = nullptr;
+	std::vector<Side> sides;
+	// Battles that take longer than this are a draw. The default is five minutes.
+	int frames = 60 * 60 * 5;
+	int runs = 1;
+	// The seed of the first run. Every following run adds one to it.
+	uint64_t seed = 0;
+};
+
+
+
+#endif
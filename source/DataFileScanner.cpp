@@ -0,0 +1,84 @@
+// SPDX-License-Identifier: GPL-3.0
+
+#include "DataFileScanner.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+	// DataFile treats every control character as whitespace, too.
+	bool IsSpace(char c)
+	{
+		return static_cast<unsigned char>(c) <= ' ';
+	}
+}
+
+
+
+DataFileScanner::DataFileScanner(const string &path)
+	: file(path)
+{
+	string_view text = file.View();
+	// Skip the byte order mark that some editors add to UTF-8 files.
+	if(text.substr(0, 3) == "\xEF\xBB\xBF")
+		text.remove_prefix(3);
+
+	size_t pos = 0;
+	while(pos < text.size())
+	{
+		const size_t end = min(text.find('\n', pos), text.size());
+		const string_view line = text.substr(pos, end - pos);
+		pos = end + 1;
+
+		// Indented lines are children, and empty lines and comments have no tokens.
+		if(line.empty() || IsSpace(line[0]) || line[0] == '#')
+			continue;
+
+		RootNode node;
+		size_t i = 0;
+		while(i < line.size() && node.size < 2)
+		{
+			string_view token;
+			if(line[i] == '"' || line[i] == '`')
+			{
+				// A quoted token ends at the matching quote or at the end of the line.
+				const size_t close = line.find(line[i], i + 1);
+				const size_t tokenEnd = min(close, line.size());
+				token = line.substr(i + 1, tokenEnd - i - 1);
+				i = close == string_view::npos ? line.size() : close + 1;
+			}
+			else
+			{
+				size_t tokenEnd = i;
+				while(tokenEnd < line.size() && !IsSpace(line[tokenEnd]))
+					++tokenEnd;
+				token = line.substr(i, tokenEnd - i);
+				i = tokenEnd;
+			}
+			(node.size ? node.name : node.key) = token;
+			++node.size;
+
+			while(i < line.size() && IsSpace(line[i]))
+				++i;
+			// The rest of the line is a comment.
+			if(i < line.size() && line[i] == '#')
+				break;
+		}
+		nodes.push_back(node);
+	}
+}
+
+
+
+string_view DataFileScanner::Text() const
+{
+	return file.View();
+}
+
+
+
+const vector<DataFileScanner::RootNode> &DataFileScanner::Nodes() const
+{
+	return nodes;
+}
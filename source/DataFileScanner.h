@@ -0,0 +1,46 @@
+// SPDX-License-Identifier: GPL-3.0
+
+#ifndef DATA_FILE_SCANNER_H_
+#define DATA_FILE_SCANNER_H_
+
+#include "MappedFile.h"
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+
+// Class that finds the root nodes of a data file without building its node tree.
+// The file is memory mapped, and only the first two tokens of every root node are
+// read, as views into the mapped file. It follows the same rules as DataFile:
+// children are indented, comments start with a #, and tokens containing spaces
+// are quoted with " or `.
+class DataFileScanner {
+public:
+	struct RootNode {
+		// The first two tokens of the node. They stay valid as long as the scanner.
+		std::string_view key;
+		std::string_view name;
+		// The number of tokens of the node, counting at most two.
+		int size = 0;
+	};
+
+
+public:
+	explicit DataFileScanner(const std::string &path);
+
+	// The contents of the file, which stay mapped as long as the scanner exists.
+	std::string_view Text() const;
+	const std::vector<RootNode> &Nodes() const;
+
+
+private:
+	MappedFile file;
+	std::vector<RootNode> nodes;
+};
+
+
+
+#endif
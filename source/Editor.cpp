@@ -31,19 +31,26 @@
 #include "Sound.h"
 #include "SpriteSet.h"
 #include "Sprite.h"
+#include "StellarObject.h"
 #include "System.h"
 #include "TaskQueue.h"
 #include "UI.h"
 #include "Version.h"
 #include "Visual.h"
+#include "Wormhole.h"
 #include "nfd.h"
 
 #include <SDL2/SDL.h>
 
+#include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <cstdint>
 #include <map>
+#include <memory>
+#include <set>
 #include <thread>
+#include <type_traits>
 
 using namespace std;
 
@@ -74,6 +81,68 @@ namespace {
 			NFD_FreePath(path);
 		return value;
 	}
+
+
+
+	template <typename T>
+	struct IsSharedPtr : false_type {};
+	template <typename T>
+	struct IsSharedPtr<shared_ptr<T>> : true_type {};
+
+	// Copies the given images or sounds, including the objects they point to, so
+	// that loading a plugin can't change the cached ones.
+	template <typename M>
+	M CopyAssets(const M &assets)
+	{
+		M copy = assets;
+		if constexpr(IsSharedPtr<typename M::mapped_type>::value)
+			for(auto &it : copy)
+				if(it.second)
+					it.second = make_shared<typename M::mapped_type::element_type>(*it.second);
+		return copy;
+	}
+
+
+
+	// The time the given directory or any directory directly inside it last changed.
+	time_t DirectoryTimestamp(const string &path)
+	{
+		time_t timestamp = Files::Timestamp(path);
+		for(const string &directory : Files::ListDirectories(path))
+			timestamp = max(timestamp, Files::Timestamp(directory));
+		return timestamp;
+	}
+
+
+
+	template <typename T>
+	set<const T *> ObjectsOf(const EditorPlugin &plugin)
+	{
+		set<const T *> objects;
+		for(const auto &it : plugin.Objects<T>())
+			objects.insert(it.first);
+		return objects;
+	}
+
+
+
+	// Copies the base version of each given object over it, or removes it if it
+	// isn't part of the base universe. Returns false if there are objects left that
+	// the base universe doesn't have, e.g. because a plugin referred to an object
+	// it never defined.
+	template <typename T, typename S, typename B>
+	bool RevertObjects(const set<const T *> &objects, S &universe, const B &base)
+	{
+		for(const T *object : objects)
+		{
+			const string name = GetName(*object);
+			if(base.Has(name))
+				*universe.Get(name) = *base.Get(name);
+			else
+				universe.Erase(name);
+		}
+		return universe.size() == base.size();
+	}
 }
 
 
@@ -103,6 +172,7 @@ void Editor::Initialize()
 	ui.Push(mapEditorPanel);
 
 	baseAssets = GameData::Assets().SaveSnapshot();
+	baseWormholes = GameData::Wormholes().size();
 }
 
 
@@ -178,6 +248,14 @@ const UniverseObjects &Editor::Universe() const
 
 
 
+bool Editor::AssetsLoaded() const
+{
+	// Once the sets are filled in, the images themselves are uploaded on this thread.
+	return !assetsFuture.valid() || assetsFuture.wait_for(chrono::seconds(0)) == future_status::ready;
+}
+
+
+
 const Set<Sprite> &Editor::Sprites() const
 {
 	return static_cast<const Set<Sprite> &>(GameData::Assets().sprites);
@@ -210,6 +288,7 @@ void Editor::RenderMain()
 {
 	ImGui::DockSpaceOverViewport(ImGui::GetMainViewport(), ImGuiDockNodeFlags_PassthruCentralNode);
 
+	FinishSave(false);
 	if(!showEditor)
 		return;
 
@@ -245,8 +324,12 @@ void Editor::RenderMain()
 		ArenaPanel::RenderProperties(systemEditor, showArenaPanelProperties);
 	if(showArenaControl)
 		arenaControl.Render(showArenaControl);
+	if(mapEditorPanel)
+		mapEditorPanel->RenderFind();
 
 	const bool hasChanges = plugin.HasChanges();
+	// Opening or saving a plugin has to wait until the current save is done.
+	const bool isSaving = saveSnapshot != nullptr;
 
 	bool newPluginDialog = false;
 	bool openPluginDialog = false;
@@ -260,8 +343,8 @@ void Editor::RenderMain()
 	{
 		if(ImGui::BeginMenu("File"))
 		{
-			ImGui::MenuItem("New Plugin", "Ctrl+N", &newPluginDialog);
-			if(ImGui::BeginMenu("Open"))
+			ImGui::MenuItem("New Plugin", "Ctrl+N", &newPluginDialog, !isSaving);
+			if(ImGui::BeginMenu("Open", !isSaving))
 			{
 				if(ImGui::MenuItem("Plugin"))
 				{
@@ -279,14 +362,14 @@ void Editor::RenderMain()
 				}
 				ImGui::EndMenu();
 			}
-			if(ImGui::MenuItem("Save", "Ctrl+S", false, hasChanges))
+			if(ImGui::MenuItem("Save", "Ctrl+S", false, hasChanges && !isSaving))
 			{
 				if(HasPlugin())
 					SavePlugin();
 				else
 					saveAsPluginDialog = true;
 			}
-			ImGui::MenuItem("Save As", "Ctrl+Shift+S", &saveAsPluginDialog, hasChanges);
+			ImGui::MenuItem("Save As", "Ctrl+Shift+S", &saveAsPluginDialog, hasChanges && !isSaving);
 			if(ImGui::MenuItem("Quit"))
 				ShowConfirmationDialog();
 			ImGui::EndMenu();
@@ -366,10 +449,12 @@ void Editor::RenderMain()
 		ImGui::EndMainMenuBar();
 	}
 
-	// Handle gloobal shortcuts.
-	if(ImGui::GetIO().KeyCtrl && ImGui::IsKeyPressed(ImGuiKey_N))
+	// Handle gloobal shortcuts. Saving while a modal is open could save the plugin
+	// it is about to replace, or quit in the middle of it.
+	const bool isModalOpen = ImGui::GetTopMostPopupModal();
+	if(!isSaving && ImGui::GetIO().KeyCtrl && ImGui::IsKeyPressed(ImGuiKey_N))
 		newPluginDialog = true;
-	if(hasChanges && ImGui::GetIO().KeyCtrl && ImGui::IsKeyPressed(ImGuiKey_S))
+	if(hasChanges && !isSaving && !isModalOpen && ImGui::GetIO().KeyCtrl && ImGui::IsKeyPressed(ImGuiKey_S))
 	{
 		if(HasPlugin())
 			SavePlugin();
@@ -377,6 +462,48 @@ void Editor::RenderMain()
 			saveAsPluginDialog = true;
 	}
 
+	// Show the progress of the images that are still loading. Until its image is
+	// loaded, a sprite is drawn empty.
+	if(assetsFuture.valid())
+	{
+		const bool isQueued = assetsFuture.wait_for(chrono::seconds(0)) == future_status::ready;
+		const double progress = isQueued ? GameData::GetProgress() : 0.;
+		if(progress >= 1.)
+			assetsFuture = {};
+		else
+		{
+			const auto *viewport = ImGui::GetMainViewport();
+			ImGui::SetNextWindowPos(ImVec2(viewport->WorkPos.x + 10.f,
+					viewport->WorkPos.y + viewport->WorkSize.y - 10.f), ImGuiCond_Always, ImVec2(0.f, 1.f));
+			if(ImGui::Begin("Loading", nullptr, ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_AlwaysAutoResize
+					| ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoFocusOnAppearing
+					| ImGuiWindowFlags_NoNav | ImGuiWindowFlags_NoDocking))
+			{
+				ImGui::Text("Loading images and sounds");
+				ImGui::ProgressBar(progress, ImVec2(200.f, 0.f));
+			}
+			ImGui::End();
+		}
+	}
+
+	// Show the progress of the save running in the background.
+	if(isSaving)
+	{
+		const auto *viewport = ImGui::GetMainViewport();
+		ImGui::SetNextWindowPos(ImVec2(viewport->WorkPos.x + viewport->WorkSize.x - 10.f,
+				viewport->WorkPos.y + viewport->WorkSize.y - 10.f), ImGuiCond_Always, ImVec2(1.f, 1.f));
+		if(ImGui::Begin("Saving", nullptr, ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_AlwaysAutoResize
+				| ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoFocusOnAppearing
+				| ImGuiWindowFlags_NoNav | ImGuiWindowFlags_NoDocking))
+		{
+			const size_t written = saveSnapshot->FilesWritten();
+			const size_t total = saveSnapshot->FileCount();
+			ImGui::Text("Saving plugin (%zu/%zu files)", written, total);
+			ImGui::ProgressBar(total ? static_cast<float>(written) / total : 1.f, ImVec2(200.f, 0.f));
+		}
+		ImGui::End();
+	}
+
 	// These dialogs are special.
 	if(openConfirmationDialog)
 		ImGui::OpenPopup("Open Confirmation");
@@ -426,6 +553,11 @@ void Editor::RenderMain()
 		ImGui::OpenPopup("Invalid Folder");
 	if(invalidGameFolderDialog)
 		ImGui::OpenPopup("Invalid Game Folder");
+	if(saveFailed)
+	{
+		ImGui::OpenPopup("Save Failed");
+		saveFailed = false;
+	}
 
 	if(ImGui::BeginPopupModal("New Plugin", nullptr, ImGuiWindowFlags_AlwaysAutoResize))
 	{
@@ -535,9 +667,14 @@ void Editor::RenderMain()
 			ImGui::BeginDisabled();
 		if(ImGui::Button("Save All and Quit"))
 		{
-			ui.Quit();
 			showConfirmationDialog = false;
+			FinishSave(true);
 			SavePlugin();
+			// Wait for the save, so that the editor stays open if it failed and the
+			// error can be shown.
+			FinishSave(true);
+			if(!saveFailed)
+				ui.Quit();
 			ImGui::CloseCurrentPopup();
 		}
 		if(!HasPlugin())
@@ -573,6 +710,11 @@ void Editor::RenderMain()
 		ImGui::Text("Also make sure you didn't select a plugin by accident.");
 		ImGui::EndPopup();
 	}
+	if(ImGui::BeginPopup("Save Failed", ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoResize))
+	{
+		ImGui::Text("Some files of the plugin couldn't be written! Their changes are still unsaved.");
+		ImGui::EndPopup();
+	}
 }
 
 
@@ -588,6 +730,21 @@ void Editor::ShowConfirmationDialog()
 
 
 
+void Editor::FinishSave(bool wait)
+{
+	if(!saveSnapshot)
+		return;
+	if(!wait && saveFuture.wait_for(chrono::seconds(0)) != future_status::ready)
+		return;
+
+	saveFuture.wait();
+	saveFailed = !plugin.FinishSave(*saveSnapshot);
+	saveSnapshot.reset();
+	saveFuture = {};
+}
+
+
+
 void Editor::ResetEditor()
 {
 	effectEditor.Clear();
@@ -619,6 +776,101 @@ void Editor::ResetPanels()
 }
 
 
+void Editor::FindBaseAssets(GameAssets::SoundMap &sounds, GameAssets::ImageMap &images)
+{
+	// The resources of the game rarely change while the editor is running, so they
+	// are only searched again if one of their directories changed.
+	const string soundPath = Files::Resources() + "sounds/";
+	const time_t soundTime = DirectoryTimestamp(soundPath);
+	if(baseSounds.empty() || soundTime != baseSoundsTime)
+	{
+		baseSounds.clear();
+		GameData::Assets().FindSounds(baseSounds, soundPath);
+		baseSoundsTime = soundTime;
+	}
+
+	const string imagePath = Files::Resources() + "images/";
+	const time_t imageTime = DirectoryTimestamp(imagePath);
+	if(baseImages.empty() || imageTime != baseImagesTime)
+	{
+		baseImages.clear();
+		GameData::Assets().FindImages(baseImages, imagePath);
+		baseImagesTime = imageTime;
+	}
+
+	sounds = CopyAssets(baseSounds);
+	images = CopyAssets(baseImages);
+}
+
+
+
+void Editor::LoadAssets(const string &path)
+{
+	assetsFuture = TaskQueue::Run([this, path]
+		{
+			// Find the new images and sounds to load from the plugin.
+			GameAssets::SoundMap sounds;
+			GameAssets::ImageMap images;
+			FindBaseAssets(sounds, images);
+			GameData::Assets().LoadSounds(path + "sounds/", std::move(sounds));
+			GameData::Assets().LoadSprites(path + "images/", std::move(images));
+		});
+}
+
+
+
+bool Editor::RevertPluginObjects()
+{
+	// Unknown nodes can change anything, e.g. events and substitutions.
+	if(plugin.HasUnknownNodes())
+		return false;
+
+	auto systems = ObjectsOf<System>(plugin);
+	auto planets = ObjectsOf<Planet>(plugin);
+	// Loading a system also changes the systems it is linked to and the planets
+	// in it, as well as the ones it was linked to and had before the plugin
+	// changed it. These need to be found before anything is removed.
+	const auto addNeighbors = [&systems, &planets](const System &system)
+	{
+		for(const System *link : system.Links())
+			systems.insert(link);
+		for(const StellarObject &stellar : system.Objects())
+			if(stellar.GetPlanet())
+				planets.insert(stellar.GetPlanet());
+	};
+	for(const System *system : ObjectsOf<System>(plugin))
+	{
+		addNeighbors(*system);
+		if(baseAssets.systems.Has(system->TrueName()))
+			addNeighbors(*baseAssets.systems.Get(system->TrueName()));
+	}
+
+	// Wormholes are generated from the planets that have one, and reverting these
+	// planets would leave their wormholes behind.
+	const auto &wormholes = GameData::Wormholes();
+	if(wormholes.size() != baseWormholes)
+		return false;
+	for(const Planet *planet : planets)
+		if(planet->IsWormhole() || wormholes.Has(planet->TrueName()))
+			return false;
+
+	UniverseObjects &universe = Universe();
+	bool reverted = RevertObjects(ObjectsOf<Effect>(plugin), universe.effects, baseAssets.effects);
+	reverted &= RevertObjects(ObjectsOf<Fleet>(plugin), universe.fleets, baseAssets.fleets);
+	reverted &= RevertObjects(ObjectsOf<Galaxy>(plugin), universe.galaxies, baseAssets.galaxies);
+	reverted &= RevertObjects(ObjectsOf<Hazard>(plugin), universe.hazards, baseAssets.hazards);
+	reverted &= RevertObjects(ObjectsOf<Government>(plugin), universe.governments, baseAssets.governments);
+	reverted &= RevertObjects(ObjectsOf<Outfit>(plugin), universe.outfits, baseAssets.outfits);
+	reverted &= RevertObjects(ObjectsOf<Sale<Outfit>>(plugin), universe.outfitSales, baseAssets.outfitSales);
+	reverted &= RevertObjects(planets, universe.planets, baseAssets.planets);
+	reverted &= RevertObjects(ObjectsOf<Ship>(plugin), universe.ships, baseAssets.ships);
+	reverted &= RevertObjects(ObjectsOf<Sale<Ship>>(plugin), universe.shipSales, baseAssets.shipSales);
+	reverted &= RevertObjects(systems, universe.systems, baseAssets.systems);
+	return reverted;
+}
+
+
+
 void Editor::NewPlugin(const string &plugin, bool reset)
 {
 	auto pluginsPath = Files::Config() + "plugins/";
@@ -648,12 +900,17 @@ void Editor::NewPlugin(const string &plugin, bool reset)
 
 bool Editor::OpenPlugin(const string &plugin)
 {
+	// The save of the current plugin needs to be finished before anything is
+	// reverted or loaded.
+	FinishSave(true);
+
 	// Don't show invalid path dialog if the user pressed cancel.
 	if(plugin.empty())
 		return true;
 	if(!Files::Exists(plugin) || !Files::Exists(plugin + "data/"))
 		return false;
 
+	const bool wasGameData = isGameData;
 	currentPluginPath = plugin + "data/";
 	isGameData = false;
 
@@ -661,30 +918,29 @@ bool Editor::OpenPlugin(const string &plugin)
 	ResetEditor();
 	ResetPanels();
 
-	// Revert to the base state.
-	GameData::Assets().Revert(baseAssets);
+	// The images and sounds of the previous plugin need to be queued before the
+	// next one can be loaded.
+	if(assetsFuture.valid())
+		assetsFuture.wait();
+
+	// Revert to the base state. Usually only the objects of the previous plugin
+	// need to be reverted, instead of copying the whole universe.
+	if(wasGameData || !RevertPluginObjects())
+		GameData::Assets().Revert(baseAssets);
 
-	auto future = TaskQueue::Run([this, plugin]
+	auto future = TaskQueue::Run([this]
 		{
 			// Load the plugin.
 			GameData::Assets().LoadObjects(currentPluginPath);
-			// Find the new images and sounds to load from the plugin.
-			GameAssets::SoundMap sounds;
-			GameData::Assets().FindSounds(sounds, Files::Resources() + "sounds/");
-			GameData::Assets().LoadSounds(plugin + "sounds/", std::move(sounds));
-
-			GameAssets::ImageMap images;
-			GameData::Assets().FindImages(images, Files::Resources() + "images/");
-			GameData::Assets().LoadSprites(plugin + "images/", std::move(images));
-
 			this->plugin.Load(*this, currentPluginPath);
 		});
 
 	showEditor = false;
-	ui.Push(new GameLoadingPanel([this, future = std::move(future)](GameLoadingPanel *This)
+	ui.Push(new GameLoadingPanel([this, plugin, future = std::move(future)](GameLoadingPanel *This)
 		{
 			future.wait();
 			ui.Pop(This);
+			ImGui::InvalidateComboSearch();
 
 			mapEditorPanel = make_shared<MapEditorPanel>(*this, &planetEditor, &systemEditor);
 			mainEditorPanel = make_shared<MainEditorPanel>(*this, &planetEditor, &systemEditor);
@@ -693,6 +949,7 @@ bool Editor::OpenPlugin(const string &plugin)
 			arenaControl.SetArena(arenaPanel);
 
 			ui.Push(mapEditorPanel);
+			LoadAssets(plugin);
 		}, showEditor));
 
 	return true;
@@ -702,6 +959,10 @@ bool Editor::OpenPlugin(const string &plugin)
 
 bool Editor::OpenGameData(const string &game)
 {
+	// The save of the current plugin needs to be finished before anything is
+	// reverted or loaded.
+	FinishSave(true);
+
 	// Don't show invalid path dialog if the user pressed cancel.
 	if(game.empty())
 		return true;
@@ -716,30 +977,27 @@ bool Editor::OpenGameData(const string &game)
 	ResetEditor();
 	ResetPanels();
 
+	// The images and sounds of the previous plugin need to be queued before the
+	// next one can be loaded.
+	if(assetsFuture.valid())
+		assetsFuture.wait();
+
 	// Revert to nothing.
 	GameData::Assets().Revert({});
 
-	auto future = TaskQueue::Run([this, game]
+	auto future = TaskQueue::Run([this]
 		{
 			// Load the plugin.
 			GameData::Assets().LoadObjects(currentPluginPath);
-			// Find the new images and sounds to load from the plugin.
-			GameAssets::SoundMap sounds;
-			GameData::Assets().FindSounds(sounds, Files::Resources() + "sounds/");
-			GameData::Assets().LoadSounds(game + "sounds/", std::move(sounds));
-
-			GameAssets::ImageMap images;
-			GameData::Assets().FindImages(images, Files::Resources() + "images/");
-			GameData::Assets().LoadSprites(game + "images/", std::move(images));
-
 			this->plugin.Load(*this, currentPluginPath);
 		});
 
 	showEditor = false;
-	ui.Push(new GameLoadingPanel([this, future = std::move(future)](GameLoadingPanel *This)
+	ui.Push(new GameLoadingPanel([this, game, future = std::move(future)](GameLoadingPanel *This)
 		{
 			future.wait();
 			ui.Pop(This);
+			ImGui::InvalidateComboSearch();
 
 			mapEditorPanel = make_shared<MapEditorPanel>(*this, &planetEditor, &systemEditor);
 			mainEditorPanel = make_shared<MainEditorPanel>(*this, &planetEditor, &systemEditor);
@@ -748,6 +1006,7 @@ bool Editor::OpenGameData(const string &game)
 			arenaControl.SetArena(arenaPanel);
 
 			ui.Push(mapEditorPanel);
+			LoadAssets(game);
 		}, showEditor));
 
 	return true;
@@ -757,10 +1016,16 @@ bool Editor::OpenGameData(const string &game)
 
 void Editor::SavePlugin()
 {
-	if(!HasPlugin())
+	if(!HasPlugin() || saveSnapshot)
 		return;
 
-	plugin.Save(*this, currentPluginPath);
+	// The text of the objects is generated before the save begins, so that they can
+	// keep being edited while the snapshot is written on a worker thread.
+	saveSnapshot = plugin.TakeSnapshot(*this, currentPluginPath);
+	saveFuture = TaskQueue::Run([snapshot = saveSnapshot]
+		{
+			snapshot->Write();
+		});
 }
 
 
@@ -22,7 +22,10 @@
 #include "EditorPlugin.h"
 #include "UniverseObjects.h"
 
+#include <cstddef>
 #include <cstdint>
+#include <ctime>
+#include <future>
 #include <memory>
 #include <set>
 #include <string>
@@ -61,6 +64,9 @@ public:
 	void RenderMain();
 
 	void ShowConfirmationDialog();
+	// Finishes the plugin save running in the background, if any. Unless wait is
+	// true, this does nothing if the save is still running.
+	void FinishSave(bool wait);
 
 	bool HasPlugin() const;
 	const std::string &GetPluginPath() const;
@@ -69,6 +75,9 @@ public:
 	const GameAssets::Snapshot &BaseUniverse() const;
 	UniverseObjects &Universe();
 	const UniverseObjects &Universe() const;
+	// The sprites and sounds are filled in by a background thread after opening a
+	// plugin, and must not be searched or looked up until that is done.
+	bool AssetsLoaded() const;
 	const Set<Sprite> &Sprites() const;
 	const Set<Sound> &Sounds() const;
 	const SpriteSet &Spriteset() const;
@@ -83,6 +92,16 @@ public:
 private:
 	void ResetEditor();
 	void ResetPanels();
+	// Reverts the objects of the current plugin, and the objects that loading them
+	// changed, to the base universe. Returns false if the plugin may have changed
+	// anything else, in which case the whole universe needs to be reverted.
+	bool RevertPluginObjects();
+	// Finds the images and sounds of the game's resources, which every plugin
+	// builds upon.
+	void FindBaseAssets(GameAssets::SoundMap &sounds, GameAssets::ImageMap &images);
+	// Starts loading the images and sounds of the game and of the plugin at the
+	// given path in the background, so that the editor can be used in the meantime.
+	void LoadAssets(const std::string &path);
 
 	void NewPlugin(const std::string &plugin, bool reset = true);
 	bool OpenPlugin(const std::string &plugin);
@@ -113,6 +132,15 @@ private:
 
 	// The base universe of the game without any plugins.
 	GameAssets::Snapshot baseAssets;
+	// The number of wormholes of the base universe. They are generated from the
+	// planets, and aren't part of the snapshot.
+	std::size_t baseWormholes = 0;
+	// The images and sounds of the game's resources, and the time their directories
+	// last changed.
+	GameAssets::SoundMap baseSounds;
+	GameAssets::ImageMap baseImages;
+	std::time_t baseSoundsTime = 0;
+	std::time_t baseImagesTime = 0;
 
 	std::shared_ptr<MapEditorPanel> mapEditorPanel;
 	std::shared_ptr<MainEditorPanel> mainEditorPanel;
@@ -123,6 +151,13 @@ private:
 
 	EditorPlugin plugin;
 	std::string currentPluginPath;
+	// The plugin save running in the background, if any.
+	std::shared_ptr<EditorPlugin::Snapshot> saveSnapshot;
+	std::shared_future<void> saveFuture;
+	// Whether the last save couldn't write every file.
+	bool saveFailed = false;
+	// Queues the images and sounds of the plugin that was opened last.
+	std::shared_future<void> assetsFuture;
 	bool isGameData = false;
 
 	bool showConfirmationDialog = false;
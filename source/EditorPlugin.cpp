@@ -3,11 +3,24 @@
 #include "EditorPlugin.h"
 
 #include "DataFile.h"
+#include "DataFileScanner.h"
 #include "DataWriter.h"
 #include "Editor.h"
 #include "Files.h"
+#include "Ship.h"
 #include "TemplateEditor.h"
 
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <istream>
+#include <memory>
+#include <streambuf>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
 using namespace std;
 
 namespace {
@@ -41,6 +54,56 @@ auto &GetEditorForNodeElement(const Editor &editor)
 		assert(!"no editor for T");
 }
 
+
+
+// The type of object a root node of a data file defines.
+enum class NodeType {
+	EFFECT, FLEET, GALAXY, HAZARD, GOVERNMENT, OUTFIT, OUTFITTER, PLANET, SHIP, SHIPYARD, SYSTEM, UNKNOWN
+};
+
+NodeType TypeOf(string_view key)
+{
+	static const unordered_map<string_view, NodeType> types = {
+		{"effect", NodeType::EFFECT},
+		{"fleet", NodeType::FLEET},
+		{"galaxy", NodeType::GALAXY},
+		{"hazard", NodeType::HAZARD},
+		{"government", NodeType::GOVERNMENT},
+		{"outfit", NodeType::OUTFIT},
+		{"outfitter", NodeType::OUTFITTER},
+		{"planet", NodeType::PLANET},
+		{"ship", NodeType::SHIP},
+		{"shipyard", NodeType::SHIPYARD},
+		{"system", NodeType::SYSTEM},
+	};
+
+	auto it = types.find(key);
+	return it != types.end() ? it->second : NodeType::UNKNOWN;
+}
+
+
+
+// A read-only stream over memory, so that a mapped file can be parsed without
+// reading it again.
+class MemoryBuffer : public streambuf {
+public:
+	explicit MemoryBuffer(string_view text)
+	{
+		char *begin = const_cast<char *>(text.data());
+		setg(begin, begin, begin + text.size());
+	}
+};
+
+
+
+// The type and name of a root node, and the node itself if the editor doesn't
+// know its type.
+struct RootNode {
+	NodeType type;
+	string name;
+	DataNode *node = nullptr;
+};
+
 }
 
 
@@ -49,46 +112,125 @@ void EditorPlugin::Load(const Editor &editor, string_view path)
 	data.clear();
 	unknownNodes.clear();
 	filesChanged.clear();
+	dirtyObjects.clear();
+	cachedText.clear();
 	hasModifications = false;
+	effects.clear();
+	fleets.clear();
+	galaxies.clear();
+	hazards.clear();
+	governments.clear();
+	outfits.clear();
+	outfitters.clear();
+	planets.clear();
+	ships.clear();
+	shipyards.clear();
+	systems.clear();
 
 	// We assume that path refers to a valid path to the root of the plugin.
-	auto files = Files::RecursiveList(string(path));
-	for(const auto &file : files)
+	const auto files = Files::RecursiveList(string(path));
+
+	// Every file gets parsed into its own slot, so that the results can be merged
+	// in the same order as the file list no matter which worker finished first.
+	vector<DataFile> parsed(files.size());
+	vector<vector<RootNode>> nodes(files.size());
+	atomic<size_t> nextFile{0};
+	auto worker = [&files, &parsed, &nodes, &nextFile]
 	{
-		const auto filename = file.substr(path.size());
-		for(auto &node : DataFile(file))
+		for(size_t i = nextFile++; i < files.size(); i = nextFile++)
 		{
-			const string &key = node.Token(0);
-			if(node.Size() < 2)
+			// Only the type and name of the objects the editor knows are needed here,
+			// so files without other root nodes don't need to be parsed completely.
+			const DataFileScanner scanner(files[i]);
+			const auto &roots = scanner.Nodes();
+			if(none_of(roots.begin(), roots.end(), [](const DataFileScanner::RootNode &root)
+					{
+						return root.size >= 2 && TypeOf(root.key) == NodeType::UNKNOWN;
+					}))
+			{
+				nodes[i].reserve(roots.size());
+				for(const auto &root : roots)
+					if(root.size >= 2)
+						nodes[i].push_back({TypeOf(root.key), string(root.name)});
 				continue;
-			const auto &value = node.Token(1);
-
-			if(key == "effect")
-				data[filename].emplace_back(effects.emplace(editor.Universe().effects.Get(value), filename).first->first);
-			else if(key == "fleet")
-				data[filename].emplace_back(fleets.emplace(editor.Universe().fleets.Get(value), filename).first->first);
-			else if(key == "galaxy")
-				data[filename].emplace_back(galaxies.emplace(editor.Universe().galaxies.Get(value), filename).first->first);
-			else if(key == "hazard")
-				data[filename].emplace_back(hazards.emplace(editor.Universe().hazards.Get(value), filename).first->first);
-			else if(key == "government")
-				data[filename].emplace_back(governments.emplace(editor.Universe().governments.Get(value), filename).first->first);
-			else if(key == "outfit")
-				data[filename].emplace_back(outfits.emplace(editor.Universe().outfits.Get(value), filename).first->first);
-			else if(key == "outfitter")
-				data[filename].emplace_back(outfitters.emplace(editor.Universe().outfitSales.Get(value), filename).first->first);
-			else if(key == "planet")
-				data[filename].emplace_back(planets.emplace(editor.Universe().planets.Get(value), filename).first->first);
-			else if(key == "ship")
-				data[filename].emplace_back(ships.emplace(editor.Universe().ships.Get(value), filename).first->first);
-			else if(key == "shipyard")
-				data[filename].emplace_back(shipyards.emplace(editor.Universe().shipSales.Get(value), filename).first->first);
-			else if(key == "system")
-				data[filename].emplace_back(systems.emplace(editor.Universe().systems.Get(value), filename).first->first);
-			else
+			}
+
+			// The unknown nodes are kept as they are, so the file is parsed completely
+			// from the memory that was already mapped.
+			MemoryBuffer buffer(scanner.Text());
+			istream in(&buffer);
+			parsed[i].Load(in);
+			for(auto &node : parsed[i])
+			{
+				if(node.Size() < 2)
+					continue;
+				// The parsed files are owned by this function, so their unknown nodes can
+				// be moved into the plugin instead of being copied.
+				nodes[i].push_back({TypeOf(node.Token(0)), node.Token(1), const_cast<DataNode *>(&node)});
+			}
+		}
+	};
+
+	// This function already runs on a TaskQueue task, so the workers use their own
+	// threads instead of waiting on the queue from inside one of its tasks.
+	const size_t threadCount = min<size_t>(files.size(), max(1u, thread::hardware_concurrency()));
+	vector<thread> threads;
+	for(size_t i = 1; i < threadCount; ++i)
+		threads.emplace_back(worker);
+	worker();
+	for(auto &thread : threads)
+		thread.join();
+
+	// Looking up the objects creates them if necessary, so this needs to be done serially.
+	for(size_t i = 0; i < files.size(); ++i)
+	{
+		const auto filename = files[i].substr(path.size());
+		if(nodes[i].empty())
+			continue;
+
+		auto &fileData = data[filename];
+		fileData.reserve(nodes[i].size());
+		for(const auto &[type, value, node] : nodes[i])
+		{
+			switch(type)
 			{
-				unknownNodes.emplace_back(std::move(node));
-				data[filename].emplace_back(&unknownNodes.back());
+			case NodeType::EFFECT:
+				fileData.emplace_back(effects.emplace(editor.Universe().effects.Get(value), filename).first->first);
+				break;
+			case NodeType::FLEET:
+				fileData.emplace_back(fleets.emplace(editor.Universe().fleets.Get(value), filename).first->first);
+				break;
+			case NodeType::GALAXY:
+				fileData.emplace_back(galaxies.emplace(editor.Universe().galaxies.Get(value), filename).first->first);
+				break;
+			case NodeType::HAZARD:
+				fileData.emplace_back(hazards.emplace(editor.Universe().hazards.Get(value), filename).first->first);
+				break;
+			case NodeType::GOVERNMENT:
+				fileData.emplace_back(governments.emplace(editor.Universe().governments.Get(value), filename).first->first);
+				break;
+			case NodeType::OUTFIT:
+				fileData.emplace_back(outfits.emplace(editor.Universe().outfits.Get(value), filename).first->first);
+				break;
+			case NodeType::OUTFITTER:
+				fileData.emplace_back(outfitters.emplace(editor.Universe().outfitSales.Get(value), filename).first->first);
+				break;
+			case NodeType::PLANET:
+				fileData.emplace_back(planets.emplace(editor.Universe().planets.Get(value), filename).first->first);
+				break;
+			case NodeType::SHIP:
+				fileData.emplace_back(ships.emplace(editor.Universe().ships.Get(value), filename).first->first);
+				break;
+			case NodeType::SHIPYARD:
+				fileData.emplace_back(shipyards.emplace(editor.Universe().shipSales.Get(value), filename).first->first);
+				break;
+			case NodeType::SYSTEM:
+				fileData.emplace_back(systems.emplace(editor.Universe().systems.Get(value), filename).first->first);
+				break;
+			case NodeType::UNKNOWN:
+				unknownNodes.emplace_back(std::move(*node));
+				fileData.emplace_back(&unknownNodes.back());
+				break;
 			}
 		}
 	}
@@ -96,33 +238,96 @@ void EditorPlugin::Load(const Editor &editor, string_view path)
 
 
 
-void EditorPlugin::Save(const Editor &editor, string_view path)
+bool EditorPlugin::Save(const Editor &editor, string_view path)
 {
+	auto snapshot = TakeSnapshot(editor, path);
+	snapshot->Write();
+	return FinishSave(*snapshot);
+}
+
+
+
+shared_ptr<EditorPlugin::Snapshot> EditorPlugin::TakeSnapshot(const Editor &editor, string_view path)
+{
+	auto snapshot = make_shared<Snapshot>();
+	snapshot->generation = cacheGeneration;
 	for(const auto &[file, objects] : data)
 	{
 		// Skip files that haven't been modified by this plugin editor.
 		if(!filesChanged.count(file))
 			continue;
 
-		DataWriter writer(string(path) + file);
+		auto &snapshotFile = snapshot->files.emplace_back();
+		snapshotFile.name = file;
+		snapshotFile.path = string(path) + file;
+		snapshotFile.objects.reserve(objects.size());
 		for(const auto &object : objects)
 		{
-			std::visit([this, &writer, &editor](const auto *ptr)
+			auto &copy = snapshotFile.objects.emplace_back();
+			copy.node = object;
+			// Objects that were removed still leave their empty line behind.
+			if(!Has(object))
+				continue;
+
+			auto it = cachedText.find(object);
+			if(it != cachedText.end() && !dirtyObjects.count(object))
+			{
+				copy.text = it->second;
+				continue;
+			}
+
+			// The objects are generated here and not by the thread writing the files,
+			// because writing them reads other objects that the editor can modify.
+			DataWriter writer;
+			std::visit([&editor, &writer](const auto *ptr)
 				{
-					if constexpr(std::is_same_v<decltype(ptr), const DataNode *>)
+					using T = decltype(ptr);
+					if constexpr(std::is_same_v<T, const DataNode *>)
 						writer.Write(*ptr);
 					else
-					{
-						const auto &map = GetMapForNodeElement<decltype(ptr)>();
-						if(map.count(ptr))
-							GetEditorForNodeElement<decltype(ptr)>(editor).WriteToFile(writer, ptr);
-					}
+						GetEditorForNodeElement<T>(editor).WriteToFile(writer, ptr);
 				}, object);
-
-			writer.Write();
+			copy.text = writer.SaveToString();
+			copy.generated = true;
+			dirtyObjects.erase(object);
 		}
 	}
+
+	filesChanged.clear();
 	hasModifications = false;
+	return snapshot;
+}
+
+
+
+bool EditorPlugin::FinishSave(Snapshot &snapshot)
+{
+	bool succeeded = true;
+	for(auto &file : snapshot.files)
+	{
+		if(!file.failed)
+			continue;
+
+		// The objects of a file that couldn't be written still need to be saved.
+		succeeded = false;
+		hasModifications = true;
+		filesChanged.insert(file.name);
+		for(const auto &object : file.objects)
+			if(object.generated && Has(object.node))
+				dirtyObjects.insert(object.node);
+	}
+
+	// Everything generated by the snapshot is outdated if the cache was invalidated
+	// while it was being written.
+	if(snapshot.generation != cacheGeneration)
+		return succeeded;
+
+	for(auto &file : snapshot.files)
+		if(!file.failed)
+			for(auto &object : file.objects)
+				if(object.generated && Has(object.node) && !dirtyObjects.count(object.node))
+					cachedText[object.node] = std::move(object.text);
+	return succeeded;
 }
 
 
@@ -137,6 +342,7 @@ bool EditorPlugin::HasChanges() const
 void EditorPlugin::Add(Node node)
 {
 	hasModifications = true;
+	ModifyVariantsOf(node);
 
 	// If the modified node is already present, we don't need to add it.
 	if(std::visit([this](const auto *ptr)
@@ -149,6 +355,7 @@ void EditorPlugin::Add(Node node)
 					{
 						// But we do need to save that we have touch a node in this file.
 						filesChanged.insert(it->second);
+						dirtyObjects.insert(ptr);
 						return true;
 					}
 				}
@@ -171,6 +378,7 @@ void EditorPlugin::Add(Node node)
 				assert(!"can't add a DataNode");
 		}, node);
 
+	dirtyObjects.insert(node);
 	data[file].emplace_back(std::move(node));
 	filesChanged.insert(file);
 }
@@ -181,17 +389,104 @@ bool EditorPlugin::Has(const Node &node) const
 {
 	return std::visit([this](const auto *ptr)
 		{
-			return GetMapForNodeElement<decltype(ptr)>().count(ptr);
+			if constexpr(std::is_same_v<decltype(ptr), const DataNode *>)
+				return true;
+			else
+				return GetMapForNodeElement<decltype(ptr)>().count(ptr) > 0;
 		}, node);
 }
 
 
 
+bool EditorPlugin::HasUnknownNodes() const
+{
+	return !unknownNodes.empty();
+}
+
+
+
 void EditorPlugin::Remove(const Node &node)
 {
 	hasModifications = true;
+	ModifyVariantsOf(node);
 	std::visit([this](const auto *ptr)
 		{
-			GetMapForNodeElement<decltype(ptr)>().erase(ptr);
+			auto &map = GetMapForNodeElement<decltype(ptr)>();
+			auto it = map.find(ptr);
+			if(it == map.end())
+				return;
+
+			// The file this object was part of needs to be written without it.
+			filesChanged.insert(it->second);
+			map.erase(it);
 		}, node);
+	dirtyObjects.erase(node);
+	cachedText.erase(node);
+}
+
+
+
+void EditorPlugin::InvalidateCache()
+{
+	cachedText.clear();
+	++cacheGeneration;
+}
+
+
+
+void EditorPlugin::ModifyVariantsOf(const Node &node)
+{
+	// Variants are written as the differences to their model, so their text needs
+	// to be generated again whenever the model is modified.
+	const auto *ship = std::get_if<const Ship *>(&node);
+	if(!ship)
+		return;
+	for(const auto &[other, file] : ships)
+		if(other != *ship && other->ModelName() == (*ship)->ModelName())
+		{
+			dirtyObjects.insert(other);
+			filesChanged.insert(file);
+		}
+}
+
+
+
+void EditorPlugin::Snapshot::Write()
+{
+	for(auto &file : files)
+	{
+		string contents;
+		for(const auto &object : file.objects)
+		{
+			contents += object.text;
+			contents += '\n';
+		}
+
+		// Files::Write doesn't report errors, so check that the whole file arrived.
+		const string temporary = file.path + ".tmp";
+		Files::Write(temporary, contents);
+		error_code error;
+		if(filesystem::file_size(temporary, error) != contents.size() || error)
+			file.failed = true;
+		else
+		{
+			Files::Move(temporary, file.path);
+			file.failed = Files::Exists(temporary);
+		}
+		++filesWritten;
+	}
+}
+
+
+
+size_t EditorPlugin::Snapshot::FilesWritten() const
+{
+	return filesWritten;
+}
+
+
+
+size_t EditorPlugin::Snapshot::FileCount() const
+{
+	return files.size();
 }
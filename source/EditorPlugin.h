@@ -5,17 +5,22 @@
 
 #include "Sale.h"
 
+#include <atomic>
 #include <cassert>
+#include <cstddef>
 #include <list>
+#include <memory>
 #include <set>
 #include <string>
 #include <string_view>
 #include <type_traits>
 #include <unordered_map>
+#include <unordered_set>
 #include <variant>
 #include <vector>
 
 class DataNode;
+class DataWriter;
 class Editor;
 class Effect;
 class Fleet;
@@ -35,12 +40,58 @@ public:
 		  const Government *, const Outfit *, const Sale<Outfit> *, const Planet *, const Ship *,
 		  const Sale<Ship> *, const System *, const DataNode *>;
 
+	// The text of every modified file of a plugin, so that the files can be written
+	// on another thread while the editor keeps running.
+	class Snapshot {
+	public:
+		// Writes every file of the snapshot. Each file is written to a temporary
+		// file first and then moved over the old one, so that a save that is
+		// interrupted never leaves a partially written data file behind.
+		void Write();
+
+		// The number of files that have been written so far, and in total.
+		std::size_t FilesWritten() const;
+		std::size_t FileCount() const;
+
+
+	private:
+		struct Object {
+			Node node;
+			std::string text;
+			// Whether the text was generated for this save instead of taken from the cache.
+			bool generated = false;
+		};
+		struct File {
+			// The path of the file, relative to the plugin.
+			std::string name;
+			std::string path;
+			std::vector<Object> objects;
+			// Whether this file couldn't be written.
+			bool failed = false;
+		};
+
+		std::vector<File> files;
+		std::atomic<std::size_t> filesWritten{0};
+		// The cache generation at the time this snapshot was taken.
+		std::size_t generation = 0;
+
+		friend class EditorPlugin;
+	};
+
 
 public:
 	// Loads the plugin at the specified path.
 	void Load(const Editor &editor, std::string_view path);
-	// Saves this plugin to the specified path.
-	void Save(const Editor &editor, std::string_view path);
+	// Saves this plugin to the specified path. Returns false if any file couldn't be written.
+	bool Save(const Editor &editor, std::string_view path);
+	// Generates the text of every modified file of this plugin, so that the
+	// snapshot can be written on another thread. The plugin counts as saved
+	// as soon as the snapshot is taken.
+	std::shared_ptr<Snapshot> TakeSnapshot(const Editor &editor, std::string_view path);
+	// Keeps the text generated by a snapshot that has finished writing, for the
+	// objects that weren't modified again in the meantime. The files that couldn't
+	// be written count as modified again. Returns false if any file couldn't be written.
+	bool FinishSave(Snapshot &snapshot);
 
 	// Whether any changes were made to this plugin since loading it.
 	bool HasChanges() const;
@@ -50,12 +101,23 @@ public:
 
 	// Checks if the specified object is part of this plugin.
 	bool Has(const Node &node) const;
+	// The objects of the given type that are part of this plugin.
+	template <typename T>
+	const std::map<const T *, std::string> &Objects() const;
+	// Whether this plugin has root nodes that the editor doesn't know about.
+	bool HasUnknownNodes() const;
 
 	// Removes the specified object as part of this plugin.
 	void Remove(const Node &node);
 
+	// Discards the saved text of every object, so that the next save writes every
+	// object in a modified file again.
+	void InvalidateCache();
+
 
 private:
+	// Marks the other ships of the same model as modified, if the given node is a ship.
+	void ModifyVariantsOf(const Node &node);
 	// Helper function that returns the map corresponding to the type of ptr.
 	template <typename T>
 	std::map<T, std::string> &GetMapForNodeElement();
@@ -71,6 +133,14 @@ private:
 	// List of data files that have modifications. This is to avoid rewriting files
 	// that haven't been touched.
 	std::set<std::string> filesChanged;
+	// The objects that have been modified since they were last written.
+	std::unordered_set<Node> dirtyObjects;
+	// The text each object had when it was last written, so that saving a file only
+	// needs to regenerate the objects that were actually modified.
+	std::unordered_map<Node, std::string> cachedText;
+	// Incremented every time the cache is invalidated, so that text generated by a
+	// save that was running at the time isn't kept.
+	std::size_t cacheGeneration = 0;
 
 	std::unordered_map<std::string, std::vector<Node>> data;
 	std::list<DataNode> unknownNodes;
@@ -90,6 +160,14 @@ private:
 
 
 
+template <typename T>
+const std::map<const T *, std::string> &EditorPlugin::Objects() const
+{
+	return GetMapForNodeElement<const T *>();
+}
+
+
+
 template <typename T>
 std::map<T, std::string> &EditorPlugin::GetMapForNodeElement()
 {
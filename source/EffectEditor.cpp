@@ -71,6 +71,7 @@ void EffectEditor::Render()
 			{
 				editor.GetPlugin().Remove(object);
 				editor.Universe().effects.Erase(object->name);
+				ImGui::InvalidateComboSearch();
 				object = nullptr;
 			}
 			ImGui::EndMenu();
@@ -90,6 +91,7 @@ void EffectEditor::Render()
 					return;
 
 				auto *newEffect = editor.Universe().effects.Get(name);
+				ImGui::InvalidateComboSearch();
 				newEffect->name = name;
 				object = newEffect;
 				SetDirty();
@@ -101,7 +103,7 @@ void EffectEditor::Render()
 
 				editor.Universe().effects.Rename(object->name, name);
 				object->name = name;
-				SetDirty();
+				SetRenamed();
 			});
 	ImGui::BeginSimpleCloneModal("Clone Effect", [this](const string &name)
 			{
@@ -109,6 +111,7 @@ void EffectEditor::Render()
 					return;
 
 				auto *clone = editor.Universe().effects.Get(name);
+				ImGui::InvalidateComboSearch();
 				*clone = *object;
 				object = clone;
 
@@ -136,8 +139,10 @@ void EffectEditor::RenderEffect()
 	RenderElement(object, "sprite");
 
 	string soundName = object->sound ? object->sound->Name() : "";
+	ImGui::BeginDisabled(!editor.AssetsLoaded());
 	if(ImGui::InputCombo("sound", &soundName, &object->sound, editor.Sounds()))
 		SetDirty();
+	ImGui::EndDisabled();
 
 	if(ImGui::InputInt("lifetime", &object->lifetime))
 		SetDirty();
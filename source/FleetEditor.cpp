@@ -114,6 +114,7 @@ void FleetEditor::Render()
 			{
 				editor.GetPlugin().Remove(object);
 				editor.Universe().fleets.Erase(object->fleetName);
+				ImGui::InvalidateComboSearch();
 				object = nullptr;
 			}
 			ImGui::EndMenu();
@@ -133,6 +134,7 @@ void FleetEditor::Render()
 					return;
 
 				auto *newFleet = editor.Universe().fleets.Get(name);
+				ImGui::InvalidateComboSearch();
 				newFleet->fleetName = name;
 				object = newFleet;
 				SetDirty();
@@ -144,7 +146,7 @@ void FleetEditor::Render()
 
 				editor.Universe().fleets.Rename(object->fleetName, name);
 				object->fleetName = name;
-				SetDirty();
+				SetRenamed();
 			});
 	ImGui::BeginSimpleCloneModal("Clone Fleet", [this](const string &name)
 			{
@@ -152,6 +154,7 @@ void FleetEditor::Render()
 					return;
 
 				auto *clone = editor.Universe().fleets.Get(name);
+				ImGui::InvalidateComboSearch();
 				*clone = *object;
 				object = clone;
 
@@ -72,6 +72,7 @@ void GalaxyEditor::Render()
 			{
 				editor.GetPlugin().Remove(object);
 				editor.Universe().galaxies.Erase(object->name);
+				ImGui::InvalidateComboSearch();
 				object = nullptr;
 			}
 			ImGui::EndMenu();
@@ -98,6 +99,7 @@ void GalaxyEditor::Render()
 					return;
 
 				auto *newGalaxy = editor.Universe().galaxies.Get(name);
+				ImGui::InvalidateComboSearch();
 				newGalaxy->name = name;
 				object = newGalaxy;
 				SetDirty();
@@ -109,7 +111,7 @@ void GalaxyEditor::Render()
 
 				editor.Universe().galaxies.Rename(object->name, name);
 				object->name = name;
-				SetDirty();
+				SetRenamed();
 			});
 	ImGui::BeginSimpleCloneModal("Clone Galaxy", [this](const string &name)
 			{
@@ -117,6 +119,7 @@ void GalaxyEditor::Render()
 					return;
 
 				auto *clone = editor.Universe().galaxies.Get(name);
+				ImGui::InvalidateComboSearch();
 				*clone = *object;
 				object = clone;
 
@@ -150,8 +153,10 @@ void GalaxyEditor::RenderGalaxy()
 	}
 
 	string spriteName = object->sprite ? object->sprite->Name() : "";
+	ImGui::BeginDisabled(!editor.AssetsLoaded());
 	if(ImGui::InputCombo("sprite", &spriteName, &object->sprite, editor.Sprites()))
 		SetDirty();
+	ImGui::EndDisabled();
 
 	// TODO: Maybe show the galaxy image here. ImGui doesn't support texture arrays (which
 	// we use to draw sprites), so we'd have to hack something in. *pain*
@@ -17,6 +17,7 @@
 #include "Government.h"
 #include "Hazard.h"
 #include "MainPanel.h"
+#include "MapEditorPanel.h"
 #include "MapPanel.h"
 #include "Minable.h"
 #include "Planet.h"
@@ -72,6 +73,7 @@ void GovernmentEditor::Render()
 			{
 				editor.GetPlugin().Remove(object);
 				editor.Universe().governments.Erase(object->TrueName());
+				ImGui::InvalidateComboSearch();
 				object = nullptr;
 			}
 			ImGui::EndMenu();
@@ -91,6 +93,7 @@ void GovernmentEditor::Render()
 					return;
 
 				auto *newGov = editor.Universe().governments.Get(name);
+				ImGui::InvalidateComboSearch();
 				newGov->name = name;
 				newGov->displayName = name;
 				object = newGov;
@@ -104,7 +107,7 @@ void GovernmentEditor::Render()
 				editor.Universe().governments.Rename(object->TrueName(), name);
 				object->name = name;
 				object->displayName = name;
-				SetDirty();
+				SetRenamed();
 			});
 	ImGui::BeginSimpleCloneModal("Clone Government", [this](const string &name)
 			{
@@ -112,6 +115,7 @@ void GovernmentEditor::Render()
 					return;
 
 				auto *clone = editor.Universe().governments.Get(name);
+				ImGui::InvalidateComboSearch();
 				*clone = *object;
 				object = clone;
 
@@ -148,6 +152,9 @@ void GovernmentEditor::RenderGovernment()
 	if(ImGui::ColorEdit3("color", color))
 	{
 		object->color = ExclusiveItem(Color(color[0], color[1], color[2]));
+		// The map caches the colors of the systems.
+		if(editor.MapPanel())
+			editor.MapPanel()->UpdateCache();
 		SetDirty();
 	}
 	if(ImGui::InputDoubleEx("player reputation", &object->initialPlayerReputation))
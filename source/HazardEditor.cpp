@@ -71,6 +71,7 @@ void HazardEditor::Render()
 			{
 				editor.GetPlugin().Remove(object);
 				editor.Universe().hazards.Erase(object->name);
+				ImGui::InvalidateComboSearch();
 				object = nullptr;
 			}
 			ImGui::EndMenu();
@@ -90,6 +91,7 @@ void HazardEditor::Render()
 					return;
 
 				auto *newHazard = editor.Universe().hazards.Get(name);
+				ImGui::InvalidateComboSearch();
 				newHazard->name = name;
 				object = newHazard;
 				SetDirty();
@@ -101,7 +103,7 @@ void HazardEditor::Render()
 
 				editor.Universe().hazards.Rename(object->name, name);
 				object->name = name;
-				SetDirty();
+				SetRenamed();
 			});
 	ImGui::BeginSimpleCloneModal("Clone Hazard", [this](const string &name)
 			{
@@ -109,6 +111,7 @@ void HazardEditor::Render()
 					return;
 
 				auto *clone = editor.Universe().hazards.Get(name);
+				ImGui::InvalidateComboSearch();
 				*clone = *object;
 				object = clone;
 
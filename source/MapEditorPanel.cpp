@@ -5,7 +5,6 @@
 #include "text/alignment.hpp"
 #include "Angle.h"
 #include "CargoHold.h"
-#include "Dialog.h"
 #include "Editor.h"
 #include "FillShader.h"
 #include "FogShader.h"
@@ -19,6 +18,7 @@
 #include "MainEditorPanel.h"
 #include "MapDetailPanel.h"
 #include "MapOutfitterPanel.h"
+#include "MapShader.h"
 #include "MapShipyardPanel.h"
 #include "Mission.h"
 #include "MissionPanel.h"
@@ -27,6 +27,7 @@
 #include "PointerShader.h"
 #include "Politics.h"
 #include "Preferences.h"
+#include "Rectangle.h"
 #include "RingShader.h"
 #include "Screen.h"
 #include "Ship.h"
@@ -36,13 +37,17 @@
 #include "System.h"
 #include "Trade.h"
 #include "UI.h"
+#include "imgui.h"
+#include "imgui_ex.h"
+#include "imgui_stdlib.h"
 
 #include "opengl.h"
 
 #include <algorithm>
-#include <cctype>
 #include <cmath>
 #include <limits>
+#include <set>
+#include <unordered_set>
 
 using namespace std;
 
@@ -51,16 +56,10 @@ namespace {
 	const int RECENTER_TIME = 20;
 	constexpr int MAX_ZOOM = 3;
 	constexpr int MIN_ZOOM = -3;
-
-	// Struct for storing the ends of wormhole links and their colors.
-	struct WormholeArrow {
-		WormholeArrow() = default;
-		WormholeArrow(const System *from, const System *to, const Color *color)
-		: from(from), to(to), color(color) {}
-		const System *from = nullptr;
-		const System *to = nullptr;
-		const Color *color = nullptr;
-	};
+	// The size in pixels of the cells used to keep system names from overlapping.
+	constexpr int LABEL_CELL_SIZE = 8;
+	// The number of matches listed in the find window.
+	constexpr size_t FIND_RESULTS = 10;
 }
 
 
@@ -116,9 +115,11 @@ void MapEditorPanel::Draw()
 			(playerJumpDistance + .5) * Zoom(), (playerJumpDistance - .5) * Zoom(), dimColor);
 
 	Color brightColor(.4f, 0.f);
+	RingShader::Bind();
 	for(auto &&system : selectedSystems)
-		RingShader::Draw(Zoom() * (system->Position() + center),
+		RingShader::Add(Zoom() * (system->Position() + center),
 			11.f, 9.f, brightColor);
+	RingShader::Unbind();
 
 	DrawWormholes();
 	DrawLinks();
@@ -129,8 +130,8 @@ void MapEditorPanel::Draw()
 	Point uiPoint(Screen::Left() + 100., Screen::Top() + 205.);
 
 	tradeY = uiPoint.Y() - 95.;
-	const Sprite *tradeSprite = editor.Sprites().Get("ui/map trade");
-	SpriteShader::Draw(tradeSprite, uiPoint);
+	if(editor.AssetsLoaded())
+		SpriteShader::Draw(editor.Sprites().Get("ui/map trade"), uiPoint);
 	uiPoint.X() -= 90.;
 	uiPoint.Y() -= 97.;
 
@@ -190,6 +191,54 @@ void MapEditorPanel::Draw()
 
 
 
+void MapEditorPanel::RenderFind()
+{
+	if(!showFind)
+		return;
+
+	if(!ImGui::Begin("Find", &showFind, ImGuiWindowFlags_AlwaysAutoResize))
+	{
+		ImGui::End();
+		return;
+	}
+
+	if(ImGui::IsWindowAppearing())
+		ImGui::SetKeyboardFocusHere();
+	const bool select = ImGui::InputText("##find", &findQuery, ImGuiInputTextFlags_EnterReturnsTrue);
+
+	// The results are only searched for again if the query or any name changed.
+	const auto &index = FindIndex();
+	if(!hasFindResults || findResultsQuery != findQuery)
+	{
+		findResults = index.Search(findQuery, FIND_RESULTS,
+			[this](size_t i) { return FoundSystem(i) != nullptr; });
+		findResultsQuery = findQuery;
+		hasFindResults = true;
+	}
+
+	for(size_t i = 0; i < findResults.size(); ++i)
+	{
+		const size_t found = findResults[i].index;
+		ImGui::PushID(static_cast<int>(i));
+		// The best match is selected when pressing enter.
+		if(ImGui::Selectable(index.Names()[found].c_str(), !i))
+			SelectFound(FoundSystem(found));
+		ImGui::SameLine();
+		ImGui::TextDisabled(found < findSystems ? "system" : "planet");
+		ImGui::PopID();
+	}
+
+	if(select || ImGui::IsKeyPressed(ImGuiKey_Escape))
+	{
+		if(select && !findResults.empty())
+			SelectFound(FoundSystem(findResults.front().index));
+		showFind = false;
+	}
+	ImGui::End();
+}
+
+
+
 bool MapEditorPanel::AllowsFastForward() const noexcept
 {
 	return true;
@@ -215,8 +264,8 @@ bool MapEditorPanel::KeyDown(SDL_Keycode key, Uint16 mod, const Command &command
 {
 	if(key == 'f')
 	{
-		GetUI()->Push(new Dialog(
-			this, &MapEditorPanel::Find, "Search for:"));
+		showFind = true;
+		findQuery.clear();
 		return true;
 	}
 	else if(key == SDLK_PLUS || key == SDLK_KP_PLUS || key == SDLK_EQUALS)
@@ -267,10 +316,10 @@ bool MapEditorPanel::Click(int x, int y, int clicks)
 
 	// Figure out if a system was clicked on.
 	click = Point(x, y) / Zoom() - center;
-	for(const auto &it : editor.Universe().systems)
-		if(it.second.IsValid() && click.Distance(it.second.Position()) < 15. / Zoom())
+	for(const System *system : Systems().Near(click, 15. / Zoom()))
+		if(system->IsValid())
 		{
-			auto selectedIt = find(selectedSystems.begin(), selectedSystems.end(), &it.second);
+			auto selectedIt = find(selectedSystems.begin(), selectedSystems.end(), system);
 			if(selectedIt != selectedSystems.end())
 			{
 				if(SDL_GetModState() & KMOD_SHIFT)
@@ -284,7 +333,7 @@ bool MapEditorPanel::Click(int x, int y, int clicks)
 					moveSystems = true;
 			}
 			else
-				Select(&it.second);
+				Select(system);
 
 			// On triple click we enter the system.
 			if(clicks == 3 && moveSystems)
@@ -312,10 +361,10 @@ bool MapEditorPanel::RClick(int x, int y)
 {
 	rclick = true;
 	Point click = Point(x, y) / Zoom() - center;
-	for(const auto &it : editor.Universe().systems)
-		if(it.second.IsValid() && click.Distance(it.second.Position()) < 10.)
+	for(const System *system : Systems().Near(click, 10.))
+		if(system->IsValid())
 		{
-			systemEditor->ToggleLink(&it.second);
+			systemEditor->ToggleLink(system);
 			return true;
 		}
 
@@ -343,7 +392,6 @@ bool MapEditorPanel::Drag(double dx, double dy)
 	{
 		for(auto &&system : selectedSystems)
 			systemEditor->UpdateSystemPosition(system, Point(dx, dy) / Zoom());
-		UpdateCache();
 	}
 	else if(selectSystems)
 		dragPoint += Point(dx, dy);
@@ -389,9 +437,12 @@ bool MapEditorPanel::Release(int x, int y)
 		selectedSystems.clear();
 
 		auto rect = Rectangle::WithCorners(dragSource / Zoom() - center, dragPoint / Zoom() - center);
-		for(const auto &it : editor.Universe().systems)
-			if(it.second.IsValid() && rect.Contains(it.second.Position()))
-				Select(&it.second, /*appendSelection=*/true);
+		auto systems = Systems().Inside(rect);
+		// Select the systems in the same order as they appear in the universe.
+		sort(systems.begin(), systems.end(), [](const System *lhs, const System *rhs) { return lhs->Name() < rhs->Name(); });
+		for(const System *system : systems)
+			if(system->IsValid())
+				Select(system, /*appendSelection=*/true);
 
 		// If no systems were selected then restore the previous selection.
 		if(selectedSystems.empty())
@@ -471,47 +522,6 @@ void MapEditorPanel::Select(const System *system, bool appendSelection)
 
 
 
-void MapEditorPanel::Find(const string &name)
-{
-	int bestIndex = 9999;
-	for(const auto &it : editor.Universe().systems)
-		if(it.second.IsValid())
-		{
-			int index = Search(it.first, name);
-			if(index >= 0 && index < bestIndex)
-			{
-				bestIndex = index;
-				selectedSystems.clear();
-				selectedSystems.push_back(&it.second);
-				systemEditor->Select(selectedSystems.back());
-				editor.SystemViewPanel()->Select(selectedSystems.back());
-				editor.GetArenaPanel()->SetSystem(selectedSystems.back());
-				CenterOnSystem();
-				if(!index)
-					return;
-			}
-		}
-	for(const auto &it : editor.Universe().planets)
-		if(it.second.IsValid())
-		{
-			int index = Search(it.first, name);
-			if(index >= 0 && index < bestIndex)
-			{
-				bestIndex = index;
-				selectedSystems.clear();
-				selectedSystems.push_back(it.second.GetSystem());
-				systemEditor->Select(selectedSystems.back());
-				editor.SystemViewPanel()->Select(selectedSystems.back());
-				editor.GetArenaPanel()->SetSystem(selectedSystems.back());
-				CenterOnSystem();
-				if(!index)
-					return;
-			}
-		}
-}
-
-
-
 double MapEditorPanel::Zoom() const
 {
 	return pow(1.5, zoom);
@@ -519,15 +529,6 @@ double MapEditorPanel::Zoom() const
 
 
 
-int MapEditorPanel::Search(const string &str, const string &sub)
-{
-	auto it = search(str.begin(), str.end(), sub.begin(), sub.end(),
-		[](char a, char b) { return toupper(a) == toupper(b); });
-	return (it == str.end() ? -1 : it - str.begin());
-}
-
-
-
 void MapEditorPanel::CenterOnSystem(bool immediate)
 {
 	const auto *system = selectedSystems.back();
@@ -548,40 +549,57 @@ void MapEditorPanel::UpdateCache()
 {
 	// Now, update the cache of the links.
 	links.clear();
+	linkLines.Clear();
 
 	for(const auto &it : editor.Universe().systems)
+		UpdateOwnedLinks(&it.second);
+
+	UpdateWormholes();
+
+	// The colors of the systems may have changed too.
+	for(const auto &it : editor.Universe().systems)
+		UpdateSystem(&it.second);
+}
+
+
+
+void MapEditorPanel::UpdateWormholes()
+{
+	wormholeArrows.clear();
+	wormholeCount = GameData::Wormholes().size();
+
+	// A system can host more than one set of wormholes (e.g. Cardea), and some wormholes may even
+	// share a link vector.
+	for(auto &&it : GameData::Wormholes())
 	{
-		const System *system = &it.second;
-		if(!system->IsValid())
+		if(!it.second.IsValid())
 			continue;
 
-		for(const System *link : system->Links())
-			if(link < system)
-			{
-				// Only draw links between two systems if both are
-				// valid. Also, avoid drawing twice by only drawing in the
-				// direction of increasing pointer values.
-				if(!link->IsValid())
-					continue;
-
-				Link renderLink;
-				renderLink.first = system->Position();
-				renderLink.second = link->Position();
-				// The color of the link is highlighted in red if the trade difference
-				// is too big.
-				renderLink.color = editor.Universe().colors.Get("map link")->Transparent(.5);
-				if(commodity != -1)
-				{
-					const auto &name = editor.Universe().trade.Commodities()[commodity].name;
-					int difference = abs(it.second.Trade(name) - link->Trade(name));
-					double value = (difference - 60) / 60.;
-					if(value >= 1.)
-						renderLink.color = Color(220.f / 255.f, 20.f / 255.f, 60.f / 255.f, 0.5f);
-				}
+		const Planet &p = *it.second.GetPlanet();
+		if(!p.IsValid() || !it.second.IsMappable())
+			continue;
 
-				links.emplace_back(std::move(renderLink));
-			}
+		for(auto &&link : it.second.Links())
+			if(!link.first->Inaccessible() && !link.second->Inaccessible() && p.IsInSystem(link.first))
+				wormholeArrows.push_back({link.first, link.second, it.second.GetLinkColor(), true});
 	}
+
+	// If an arrow is being drawn, the link will always be drawn too. Draw
+	// the link only for the first instance of it in this set.
+	set<pair<const System *, const System *>> arrows;
+	for(const WormholeArrow &link : wormholeArrows)
+		arrows.emplace(link.from, link.to);
+	for(WormholeArrow &link : wormholeArrows)
+		link.drawLink = link.from < link.to || !arrows.count(make_pair(link.to, link.from));
+}
+
+
+
+void MapEditorPanel::UpdateLinks(const System *system)
+{
+	UpdateOwnedLinks(system);
+	for(const System *link : system->Links())
+		UpdateOwnedLinks(link);
 }
 
 
@@ -595,27 +613,185 @@ void MapEditorPanel::UpdateJumpDistance()
 
 
 
-void MapEditorPanel::DrawWormholes()
+void MapEditorPanel::UpdateSystem(const System *system)
 {
-	// Keep track of what arrows and links need to be drawn.
-	vector<WormholeArrow> arrowsToDraw;
+	systemGrid.Update(system);
 
-	// A system can host more than one set of wormholes (e.g. Cardea), and some wormholes may even
-	// share a link vector.
-	for(auto &&it : GameData::Wormholes())
+	if(system->IsValid())
+		systemRings.Set(system, {MapShader::Ring(system->Position(), GovernmentColor(system->GetGovernment()))});
+	else
+		systemRings.Erase(system);
+
+	// The links drawn to this system start or end at its position.
+	UpdateLinkInstances(system);
+	for(const System *link : system->Links())
+		UpdateLinkInstances(link);
+}
+
+
+
+void MapEditorPanel::RemoveSystem(const System *system)
+{
+	systemGrid.Remove(system);
+	labels.erase(system);
+	links.erase(system);
+	systemRings.Erase(system);
+	linkLines.Erase(system);
+}
+
+
+
+const SearchIndex &MapEditorPanel::FindIndex()
+{
+	const auto &systems = editor.Universe().systems;
+	const auto &planets = editor.Universe().planets;
+	const size_t systemCount = systems.size();
+	const size_t planetCount = planets.size();
+	// Deleting an object and creating another keeps the counts the same, so the
+	// index is also rebuilt whenever the searches of the combo boxes are
+	// invalidated, which the editors do for every object they create, rename or
+	// delete, and which opening a plugin does too.
+	if(hasFindIndex && findSystems == systemCount && findPlanets == planetCount
+			&& findGeneration == ImGui::ComboSearchGeneration())
+		return findIndex;
+
+	vector<string> names;
+	names.reserve(systemCount + planetCount);
+	for(const auto &it : systems)
+		names.push_back(it.first);
+	for(const auto &it : planets)
+		names.push_back(it.first);
+	findIndex.Build(std::move(names));
+
+	findSystems = systemCount;
+	findPlanets = planetCount;
+	findGeneration = ImGui::ComboSearchGeneration();
+	hasFindIndex = true;
+	hasFindResults = false;
+	return findIndex;
+}
+
+
+
+const System *MapEditorPanel::FoundSystem(size_t index) const
+{
+	const string &name = findIndex.Names()[index];
+	if(index < findSystems)
 	{
-		if(!it.second.IsValid())
-			continue;
+		const System *system = editor.Universe().systems.Find(name);
+		return system && system->IsValid() ? system : nullptr;
+	}
 
-		const Planet &p = *it.second.GetPlanet();
-		if(!p.IsValid() || !it.second.IsMappable())
-			continue;
+	const Planet *planet = editor.Universe().planets.Find(name);
+	return planet && planet->IsValid() ? planet->GetSystem() : nullptr;
+}
 
-		for(auto &&link : it.second.Links())
-			if(!link.first->Inaccessible() && !link.second->Inaccessible() && p.IsInSystem(link.first))
-				arrowsToDraw.emplace_back(link.first, link.second, it.second.GetLinkColor());
 
+
+void MapEditorPanel::SelectFound(const System *system)
+{
+	if(!system)
+		return;
+
+	selectedSystems.clear();
+	selectedSystems.push_back(system);
+	systemEditor->Select(system);
+	editor.SystemViewPanel()->Select(system);
+	editor.GetArenaPanel()->SetSystem(system);
+	CenterOnSystem();
+}
+
+
+
+Rectangle MapEditorPanel::VisibleArea(double margin) const
+{
+	const Point extra(margin, margin);
+	return Rectangle::WithCorners((Screen::TopLeft() - extra) / Zoom() - center,
+		(Screen::BottomRight() + extra) / Zoom() - center);
+}
+
+
+
+void MapEditorPanel::UpdateOwnedLinks(const System *system)
+{
+	auto it = links.find(system);
+	if(it != links.end())
+		it->second.clear();
+	if(!system->IsValid())
+	{
+		linkLines.Erase(system);
+		return;
+	}
+
+	for(const System *link : system->Links())
+		if(link < system)
+		{
+			// Only draw links between two systems if both are
+			// valid. Also, avoid drawing twice by only drawing in the
+			// direction of increasing pointer values.
+			if(!link->IsValid())
+				continue;
+
+			Link renderLink;
+			renderLink.first = system;
+			renderLink.second = link;
+			// The color of the link is highlighted in red if the trade difference
+			// is too big.
+			renderLink.color = editor.Universe().colors.Get("map link")->Transparent(.5);
+			if(commodity != -1)
+			{
+				const auto &name = editor.Universe().trade.Commodities()[commodity].name;
+				int difference = abs(system->Trade(name) - link->Trade(name));
+				double value = (difference - 60) / 60.;
+				if(value >= 1.)
+					renderLink.color = Color(220.f / 255.f, 20.f / 255.f, 60.f / 255.f, 0.5f);
+			}
+
+			links[system].emplace_back(std::move(renderLink));
+		}
+
+	UpdateLinkInstances(system);
+}
+
+
+
+void MapEditorPanel::UpdateLinkInstances(const System *system)
+{
+	auto it = links.find(system);
+	if(it == links.end())
+	{
+		linkLines.Erase(system);
+		return;
+	}
+
+	vector<MapShader::Instance> instances;
+	instances.reserve(it->second.size());
+	for(const Link &link : it->second)
+		instances.push_back(MapShader::Link(link.first->Position(), link.second->Position(), link.color));
+	linkLines.Set(system, instances);
+}
+
+
+
+const SystemGrid &MapEditorPanel::Systems()
+{
+	const auto &systems = editor.Universe().systems;
+	if(systemGrid.Size() != static_cast<size_t>(systems.size()))
+	{
+		systemGrid.Clear();
+		systemRings.Clear();
+		for(const auto &it : systems)
+			UpdateSystem(&it.second);
 	}
+	return systemGrid;
+}
+
+
+
+void MapEditorPanel::DrawWormholes()
+{
+	if(wormholeCount != GameData::Wormholes().size())
+		UpdateWormholes();
 
 	static const double ARROW_LENGTH = 4.;
 	static const double ARROW_RATIO = .3;
@@ -623,25 +799,26 @@ void MapEditorPanel::DrawWormholes()
 	static const Angle RIGHT(-30.);
 	const double zoom = Zoom();
 
-	for(const WormholeArrow &link : arrowsToDraw)
+	for(const WormholeArrow &link : wormholeArrows)
 	{
+		// Compute the start and end positions of the wormhole link.
+		Point from = zoom * (link.from->Position() + center);
+		Point to = zoom * (link.to->Position() + center);
+		// Skip the arrows that are completely off screen.
+		if(max(from.X(), to.X()) < Screen::Left() || min(from.X(), to.X()) > Screen::Right()
+				|| max(from.Y(), to.Y()) < Screen::Top() || min(from.Y(), to.Y()) > Screen::Bottom())
+			continue;
+
 		// Get the wormhole link color.
 		const Color &arrowColor = *link.color;
 		const Color &wormholeDim = Color::Multiply(.33f, arrowColor);
 
-		// Compute the start and end positions of the wormhole link.
-		Point from = zoom * (link.from->Position() + center);
-		Point to = zoom * (link.to->Position() + center);
 		Point offset = (from - to).Unit() * MapPanel::LINK_OFFSET;
 		from -= offset;
 		to += offset;
 
-		// If an arrow is being drawn, the link will always be drawn too. Draw
-		// the link only for the first instance of it in this set.
-		if(link.from < link.to || !count_if(arrowsToDraw.begin(), arrowsToDraw.end(),
-			[&link](const WormholeArrow &cmp)
-			{ return cmp.from == link.to && cmp.to == link.from; }))
-				LineShader::Draw(from, to, MapPanel::LINK_WIDTH, wormholeDim);
+		if(link.drawLink)
+			LineShader::Draw(from, to, MapPanel::LINK_WIDTH, wormholeDim);
 
 		// Compute the start and end positions of the arrow edges.
 		Point arrowStem = zoom * ARROW_LENGTH * offset;
@@ -661,33 +838,54 @@ void MapEditorPanel::DrawWormholes()
 void MapEditorPanel::DrawLinks()
 {
 	double zoom = Zoom();
-	for(const auto &link : links)
+	if(MapShader::IsAvailable())
 	{
-		Point from = zoom * (link.first + center);
-		Point to = zoom * (link.second + center);
-		Point unit = (from - to).Unit() * MapPanel::LINK_OFFSET;
-		from -= unit;
-		to += unit;
-
-		LineShader::Draw(from, to, MapPanel::LINK_WIDTH, link.color);
+		MapShader::DrawLinks(linkLines, center, zoom, MapPanel::LINK_WIDTH, MapPanel::LINK_OFFSET);
+		return;
 	}
+
+	for(const auto &it : links)
+		for(const auto &link : it.second)
+		{
+			Point from = zoom * (link.first->Position() + center);
+			Point to = zoom * (link.second->Position() + center);
+			// Skip the links that are completely off screen.
+			if(max(from.X(), to.X()) < Screen::Left() || min(from.X(), to.X()) > Screen::Right()
+					|| max(from.Y(), to.Y()) < Screen::Top() || min(from.Y(), to.Y()) > Screen::Bottom())
+				continue;
+
+			Point unit = (from - to).Unit() * MapPanel::LINK_OFFSET;
+			from -= unit;
+			to += unit;
+
+			LineShader::Draw(from, to, MapPanel::LINK_WIDTH, link.color);
+		}
 }
 
 
 
 void MapEditorPanel::DrawSystems()
 {
-	// Draw the circles for the systems.
 	double zoom = Zoom();
-	for(const auto &pair : editor.Universe().systems)
+	if(MapShader::IsAvailable())
+	{
+		// Make sure that every system has a ring.
+		Systems();
+		MapShader::DrawRings(systemRings, center, zoom, MapPanel::OUTER, MapPanel::INNER);
+		return;
+	}
+
+	// Draw the circles for the systems that are on screen.
+	RingShader::Bind();
+	for(const System *system : Systems().Inside(VisibleArea(MapPanel::OUTER)))
 	{
-		const auto &system = pair.second;
-		if(!system.IsValid())
+		if(!system->IsValid())
 			continue;
 
-		Point pos = zoom * (system.Position() + center);
-		RingShader::Draw(pos, MapPanel::OUTER, MapPanel::INNER, GovernmentColor(system.GetGovernment()));
+		Point pos = zoom * (system->Position() + center);
+		RingShader::Add(pos, MapPanel::OUTER, MapPanel::INNER, GovernmentColor(system->GetGovernment()));
 	}
+	RingShader::Unbind();
 }
 
 
@@ -701,9 +899,63 @@ void MapEditorPanel::DrawNames()
 
 	// Draw names for all systems you have visited.
 	bool useBigFont = (zoom > 2.);
-	const Font &font = FontSet::Get(useBigFont ? 18 : 14);
+	const int fontSize = useBigFont ? 18 : 14;
+	const Font &font = FontSet::Get(fontSize);
 	Point offset(useBigFont ? 8. : 6., -.5 * font.Height());
-	for(const auto &pair : editor.Universe().systems)
-		font.Draw(pair.second.Name(), zoom * (pair.second.Position() + center) + offset,
-				editor.Universe().colors.Get("map name")->Transparent(.75));
+	const Color color = editor.Universe().colors.Get("map name")->Transparent(.75);
+
+	// Names are drawn to the right of their system, so leave enough room for a long
+	// name of a system that is just off screen.
+	auto systems = Systems().Inside(VisibleArea(200.));
+	// The names of the selected systems are always drawn. The other systems are
+	// sorted by name, so that the same names are drawn every frame if two overlap.
+	const unordered_set<const System *> selected(selectedSystems.begin(), selectedSystems.end());
+	sort(systems.begin(), systems.end(), [&selected](const System *lhs, const System *rhs)
+		{
+			const bool isLhsSelected = selected.count(lhs);
+			const bool isRhsSelected = selected.count(rhs);
+			if(isLhsSelected != isRhsSelected)
+				return isLhsSelected;
+			return lhs->Name() < rhs->Name();
+		});
+
+	// Names that would overlap a name that was already drawn are skipped, which
+	// is tracked using a coarse grid over the screen. The further the map is
+	// zoomed out, the larger the cells get, so that a name needs more free room
+	// around it and fewer names are laid out and drawn.
+	const int cellSize = zoom < 1. ? static_cast<int>(LABEL_CELL_SIZE / (zoom * zoom)) : LABEL_CELL_SIZE;
+	const int columns = Screen::Width() / cellSize + 1;
+	const int rows = Screen::Height() / cellSize + 1;
+	labelCells.assign(columns * rows, false);
+	for(const System *system : systems)
+	{
+		if(system->Name().empty())
+			continue;
+
+		auto &label = labels[system];
+		if(label.fontSize != fontSize || label.name != system->Name())
+		{
+			label.name = system->Name();
+			label.fontSize = fontSize;
+			label.width = font.Width(label.name);
+		}
+
+		const Point pos = zoom * (system->Position() + center) + offset;
+		const int left = max(0, static_cast<int>((pos.X() - Screen::Left()) / cellSize));
+		const int right = min(columns - 1, static_cast<int>((pos.X() + label.width - Screen::Left()) / cellSize));
+		const int top = max(0, static_cast<int>((pos.Y() - Screen::Top()) / cellSize));
+		const int bottom = min(rows - 1, static_cast<int>((pos.Y() + font.Height() - Screen::Top()) / cellSize));
+
+		bool isCovered = false;
+		for(int y = top; y <= bottom && !isCovered; ++y)
+			for(int x = left; x <= right && !isCovered; ++x)
+				isCovered = labelCells[y * columns + x];
+		if(isCovered && !selected.count(system))
+			continue;
+
+		for(int y = top; y <= bottom; ++y)
+			for(int x = left; x <= right; ++x)
+				labelCells[y * columns + x] = true;
+		font.Draw(label.name, pos, color);
+	}
 }
@@ -6,10 +6,14 @@
 #include "Panel.h"
 
 #include "Color.h"
+#include "MapShader.h"
 #include "Point.h"
+#include "SearchIndex.h"
+#include "SystemGrid.h"
 
 #include <map>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -18,6 +22,7 @@ class Editor;
 class Galaxy;
 class Government;
 class PlanetEditor;
+class Rectangle;
 class System;
 class SystemEditor;
 
@@ -37,6 +42,9 @@ public:
 	const System *Selected() const;
 	void Select(const Galaxy *galaxy);
 
+	// Renders the window used to find systems and planets by name, if it is open.
+	void RenderFind();
+
 
 protected:
 	// Only override the ones you need; the default action is to return false.
@@ -54,13 +62,9 @@ protected:
 	Color UninhabitedColor();
 
 	void Select(const System *system, bool appendSelection = false);
-	void Find(const std::string &name);
 
 	double Zoom() const;
 
-	// Function for the "find" dialogs:
-	static int Search(const std::string &str, const std::string &sub);
-
 
 protected:
 	const Editor &editor;
@@ -83,11 +87,44 @@ protected:
 	// Cache the map layout, so it doesn't have to be re-calculated every frame.
 	// The cache must be updated when the coloring mode changes.
 	void UpdateCache();
+	// Updates the cached links of the given system and of its neighbors. This must
+	// be called when the links or trade prices of a system change.
+	void UpdateLinks(const System *system);
 
 	void UpdateJumpDistance();
 
+	// Updates the position of the given system in the grid used to find the systems
+	// that were clicked on, and the ring and links drawn for it. This must be called
+	// whenever a system is created, moved, or its government changes.
+	void UpdateSystem(const System *system);
+	// Removes the given system from the grid and the map. This must be called before
+	// the system is deleted.
+	void RemoveSystem(const System *system);
+
 
 private:
+	// Recalculates which wormhole arrows and links need to be drawn.
+	void UpdateWormholes();
+	// Recalculates the links that are owned by the given system.
+	void UpdateOwnedLinks(const System *system);
+	// Uploads the cached links of the given system to the GPU.
+	void UpdateLinkInstances(const System *system);
+
+	// Rebuilds the index of system and planet names if any of them were renamed,
+	// created or deleted.
+	const SearchIndex &FindIndex();
+	// Returns the system of the given entry of the find index, or nullptr if it
+	// isn't valid.
+	const System *FoundSystem(std::size_t index) const;
+	void SelectFound(const System *system);
+
+	// Rebuilds the grid of systems and their rings, if it doesn't have every system
+	// in it.
+	const SystemGrid &Systems();
+	// Returns the area of the map that is on screen, extended by the given margin
+	// in pixels.
+	Rectangle VisibleArea(double margin) const;
+
 	void DrawWormholes();
 	void DrawLinks();
 	// Draw systems in accordance to the set commodity color scheme.
@@ -97,11 +134,58 @@ private:
 
 private:
 	struct Link {
-		Point first;
-		Point second;
+		const System *first;
+		const System *second;
 		Color color;
 	};
-	std::vector<Link> links;
+	// The links of each system. Every link is owned by the system with the higher
+	// address, and the positions of the systems are read when drawing so that moving
+	// a system doesn't invalidate any links.
+	std::unordered_map<const System *, std::vector<Link>> links;
+	// The rings of the systems and the links between them, as they are drawn by the
+	// map shader if the GPU supports it.
+	MapShader::Buffer systemRings;
+	MapShader::Buffer linkLines;
+
+	// The ends of each wormhole link and their colors.
+	struct WormholeArrow {
+		const System *from;
+		const System *to;
+		const Color *color;
+		// Whether the line of this link needs to be drawn, because it isn't drawn
+		// as part of the arrow going the other way.
+		bool drawLink;
+	};
+	std::vector<WormholeArrow> wormholeArrows;
+	// The number of wormholes when the arrows were last calculated.
+	std::size_t wormholeCount = 0;
+
+	SystemGrid systemGrid;
+
+	// The names of every system followed by the names of every planet.
+	SearchIndex findIndex;
+	std::size_t findSystems = 0;
+	std::size_t findPlanets = 0;
+	unsigned findGeneration = 0;
+	bool hasFindIndex = false;
+	// The state of the find window.
+	bool showFind = false;
+	std::string findQuery;
+	// The best matches of the query, as it was when they were searched for.
+	std::string findResultsQuery;
+	std::vector<SearchIndex::Match> findResults;
+	bool hasFindResults = false;
+
+	// The name of a system as it was last drawn, so that its size only needs to be
+	// measured again if the system is renamed.
+	struct Label {
+		std::string name;
+		int fontSize = 0;
+		double width = 0.;
+	};
+	std::unordered_map<const System *, Label> labels;
+	// Which parts of the screen are already covered by a label.
+	std::vector<bool> labelCells;
 	Point click;
 	bool isDragging = false;
 	bool rclick = false;
@@ -116,6 +200,7 @@ private:
 
 	int zoom = 0;
 
+	friend class GovernmentEditor;
 	friend class SystemEditor;
 };
 
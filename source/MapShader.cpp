@@ -0,0 +1,401 @@
+// SPDX-License-Identifier: GPL-3.0
+
+#include "MapShader.h"
+
+#include "Color.h"
+#include "Point.h"
+#include "Screen.h"
+#include "Shader.h"
+
+#include <algorithm>
+#include <cstddef>
+
+using namespace std;
+
+namespace {
+	bool isAvailable = false;
+
+	Shader ringShader;
+	GLint ringScaleI;
+	GLint ringCenterI;
+	GLint ringZoomI;
+	GLint ringRadiusI;
+	GLint ringWidthI;
+	GLint ringVertI;
+	GLint ringStartI;
+	GLint ringColorI;
+
+	Shader linkShader;
+	GLint linkScaleI;
+	GLint linkCenterI;
+	GLint linkZoomI;
+	GLint linkWidthI;
+	GLint linkGapI;
+	GLint linkVertI;
+	GLint linkStartI;
+	GLint linkEndI;
+	GLint linkColorI;
+
+	// The corners of the quad that is drawn for every instance.
+	GLuint quadVbo;
+
+	// Instancing is core in GLES 3.0, but only an extension for desktop GL 3.0.
+	void VertexAttribDivisor(GLuint attrib, GLuint divisor)
+	{
+#ifdef ES_GLES
+		glVertexAttribDivisor(attrib, divisor);
+#else
+		glVertexAttribDivisorARB(attrib, divisor);
+#endif
+	}
+
+	void DrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instances)
+	{
+#ifdef ES_GLES
+		glDrawArraysInstanced(mode, first, count, instances);
+#else
+		glDrawArraysInstancedARB(mode, first, count, instances);
+#endif
+	}
+
+	// Enables the given instance attribute of the currently bound vertex array.
+	void EnableInstanceAttrib(GLint attrib, GLint size, size_t offset)
+	{
+		glEnableVertexAttribArray(attrib);
+		glVertexAttribPointer(attrib, size, GL_FLOAT, GL_FALSE, sizeof(MapShader::Instance),
+			reinterpret_cast<const GLvoid *>(offset));
+		VertexAttribDivisor(attrib, 1);
+	}
+}
+
+
+
+MapShader::Buffer::~Buffer()
+{
+	if(vbo)
+		glDeleteBuffers(1, &vbo);
+	if(vao)
+		glDeleteVertexArrays(1, &vao);
+}
+
+
+
+void MapShader::Buffer::Set(const void *key, const vector<Instance> &instances)
+{
+	auto &keySlots = slots[key];
+	while(keySlots.size() > instances.size())
+	{
+		const size_t slot = keySlots.back();
+		this->instances[slot] = Instance{};
+		freeSlots.push_back(slot);
+		keySlots.pop_back();
+
+		dirtyBegin = min(dirtyBegin, slot);
+		dirtyEnd = max(dirtyEnd, slot + 1);
+	}
+	while(keySlots.size() < instances.size())
+	{
+		if(freeSlots.empty())
+		{
+			keySlots.push_back(this->instances.size());
+			this->instances.emplace_back();
+		}
+		else
+		{
+			keySlots.push_back(freeSlots.back());
+			freeSlots.pop_back();
+		}
+	}
+
+	for(size_t i = 0; i < instances.size(); ++i)
+	{
+		const size_t slot = keySlots[i];
+		this->instances[slot] = instances[i];
+
+		dirtyBegin = min(dirtyBegin, slot);
+		dirtyEnd = max(dirtyEnd, slot + 1);
+	}
+
+	if(keySlots.empty())
+		slots.erase(key);
+}
+
+
+
+void MapShader::Buffer::Erase(const void *key)
+{
+	Set(key, {});
+}
+
+
+
+void MapShader::Buffer::Clear()
+{
+	instances.clear();
+	slots.clear();
+	freeSlots.clear();
+	dirtyBegin = numeric_limits<size_t>::max();
+	dirtyEnd = 0;
+}
+
+
+
+void MapShader::Buffer::Upload()
+{
+	if(!vbo)
+		glGenBuffers(1, &vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+
+	// The whole buffer needs to be uploaded if it has grown. Leave some room, so that
+	// adding a few systems doesn't reallocate the buffer every time.
+	if(instances.size() > capacity)
+	{
+		capacity = max<size_t>(instances.size() * 3 / 2, 64);
+		glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(Instance), nullptr, GL_DYNAMIC_DRAW);
+		dirtyBegin = 0;
+		dirtyEnd = instances.size();
+	}
+
+	dirtyEnd = min(dirtyEnd, instances.size());
+	if(dirtyBegin < dirtyEnd)
+		glBufferSubData(GL_ARRAY_BUFFER, dirtyBegin * sizeof(Instance),
+			(dirtyEnd - dirtyBegin) * sizeof(Instance), instances.data() + dirtyBegin);
+
+	dirtyBegin = numeric_limits<size_t>::max();
+	dirtyEnd = 0;
+}
+
+
+
+void MapShader::Init()
+{
+	isAvailable = OpenGL::HasInstancingSupport();
+	if(!isAvailable)
+		return;
+
+	static const char *ringVertexCode =
+		"// vertex map ring shader\n"
+		"uniform vec2 scale;\n"
+		"uniform vec2 center;\n"
+		"uniform float zoom;\n"
+		"uniform float radius;\n"
+		"uniform float width;\n"
+
+		"in vec2 vert;\n"
+		"in vec2 start;\n"
+		"in vec4 color;\n"
+		"out vec2 coord;\n"
+		"out vec4 ringColor;\n"
+
+		"void main() {\n"
+		"  coord = (radius + width) * vert;\n"
+		"  ringColor = color;\n"
+		"  gl_Position = vec4((zoom * (start + center) + coord) * scale, 0, 1);\n"
+		"}\n";
+
+	static const char *ringFragmentCode =
+		"// fragment map ring shader\n"
+		"precision mediump float;\n"
+		"uniform float radius;\n"
+		"uniform float width;\n"
+
+		"in vec2 coord;\n"
+		"in vec4 ringColor;\n"
+		"out vec4 finalColor;\n"
+
+		"void main() {\n"
+		"  float alpha = clamp(width - abs(radius - length(coord)), 0., 1.);\n"
+		"  finalColor = ringColor * alpha;\n"
+		"}\n";
+
+	static const char *linkVertexCode =
+		"// vertex map link shader\n"
+		"uniform vec2 scale;\n"
+		"uniform vec2 center;\n"
+		"uniform float zoom;\n"
+		"uniform float width;\n"
+		"uniform float gap;\n"
+
+		"in vec2 vert;\n"
+		"in vec2 start;\n"
+		"in vec2 end;\n"
+		"in vec4 color;\n"
+		"out float offset;\n"
+		"out vec4 linkColor;\n"
+
+		"void main() {\n"
+		"  vec2 from = zoom * (start + center);\n"
+		"  vec2 to = zoom * (end + center);\n"
+		"  float len = length(to - from);\n"
+		"  vec2 unit = len > 0. ? (to - from) / len : vec2(1., 0.);\n"
+		"  from += gap * unit;\n"
+		"  to -= gap * unit;\n"
+		// Leave a pixel on either side of the link for antialiasing.
+		"  offset = vert.y * (.5 * width + 1.);\n"
+		"  linkColor = color;\n"
+		"  vec2 pos = mix(from, to, .5 * vert.x + .5) + offset * vec2(-unit.y, unit.x);\n"
+		"  gl_Position = vec4(pos * scale, 0, 1);\n"
+		"}\n";
+
+	static const char *linkFragmentCode =
+		"// fragment map link shader\n"
+		"precision mediump float;\n"
+		"uniform float width;\n"
+
+		"in float offset;\n"
+		"in vec4 linkColor;\n"
+		"out vec4 finalColor;\n"
+
+		"void main() {\n"
+		"  float alpha = clamp(.5 * width + .5 - abs(offset), 0., 1.);\n"
+		"  finalColor = linkColor * alpha;\n"
+		"}\n";
+
+	ringShader = Shader(ringVertexCode, ringFragmentCode);
+	ringScaleI = ringShader.Uniform("scale");
+	ringCenterI = ringShader.Uniform("center");
+	ringZoomI = ringShader.Uniform("zoom");
+	ringRadiusI = ringShader.Uniform("radius");
+	ringWidthI = ringShader.Uniform("width");
+	ringVertI = ringShader.Attrib("vert");
+	ringStartI = ringShader.Attrib("start");
+	ringColorI = ringShader.Attrib("color");
+
+	linkShader = Shader(linkVertexCode, linkFragmentCode);
+	linkScaleI = linkShader.Uniform("scale");
+	linkCenterI = linkShader.Uniform("center");
+	linkZoomI = linkShader.Uniform("zoom");
+	linkWidthI = linkShader.Uniform("width");
+	linkGapI = linkShader.Uniform("gap");
+	linkVertI = linkShader.Attrib("vert");
+	linkStartI = linkShader.Attrib("start");
+	linkEndI = linkShader.Attrib("end");
+	linkColorI = linkShader.Attrib("color");
+
+	GLfloat quad[] = {
+		-1.f, -1.f,
+		1.f, -1.f,
+		-1.f, 1.f,
+		1.f, 1.f
+	};
+	glGenBuffers(1, &quadVbo);
+	glBindBuffer(GL_ARRAY_BUFFER, quadVbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+
+
+bool MapShader::IsAvailable()
+{
+	return isAvailable;
+}
+
+
+
+MapShader::Instance MapShader::Ring(const Point &position, const Color &color)
+{
+	Instance instance{};
+	instance.start[0] = position.X();
+	instance.start[1] = position.Y();
+	copy(color.Get(), color.Get() + 4, instance.color);
+	return instance;
+}
+
+
+
+MapShader::Instance MapShader::Link(const Point &from, const Point &to, const Color &color)
+{
+	Instance instance{};
+	instance.start[0] = from.X();
+	instance.start[1] = from.Y();
+	instance.end[0] = to.X();
+	instance.end[1] = to.Y();
+	copy(color.Get(), color.Get() + 4, instance.color);
+	return instance;
+}
+
+
+
+void MapShader::DrawRings(Buffer &buffer, const Point &center, double zoom, float outer, float inner)
+{
+	if(buffer.instances.empty())
+		return;
+
+	if(!buffer.vao)
+	{
+		glGenVertexArrays(1, &buffer.vao);
+		glBindVertexArray(buffer.vao);
+
+		glBindBuffer(GL_ARRAY_BUFFER, quadVbo);
+		glEnableVertexAttribArray(ringVertI);
+		glVertexAttribPointer(ringVertI, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+
+		buffer.Upload();
+		EnableInstanceAttrib(ringStartI, 2, offsetof(Instance, start));
+		EnableInstanceAttrib(ringColorI, 4, offsetof(Instance, color));
+	}
+	else
+	{
+		glBindVertexArray(buffer.vao);
+		buffer.Upload();
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glUseProgram(ringShader.Object());
+	GLfloat scale[2] = {2.f / Screen::Width(), -2.f / Screen::Height()};
+	glUniform2fv(ringScaleI, 1, scale);
+	glUniform2f(ringCenterI, center.X(), center.Y());
+	glUniform1f(ringZoomI, zoom);
+	// Like the ring shader, the width includes a pixel for antialiasing.
+	const float width = .5f * (1.f + outer - inner);
+	glUniform1f(ringRadiusI, outer - width);
+	glUniform1f(ringWidthI, width);
+
+	DrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, buffer.instances.size());
+
+	glBindVertexArray(0);
+	glUseProgram(0);
+}
+
+
+
+void MapShader::DrawLinks(Buffer &buffer, const Point &center, double zoom, float width, float gap)
+{
+	if(buffer.instances.empty())
+		return;
+
+	if(!buffer.vao)
+	{
+		glGenVertexArrays(1, &buffer.vao);
+		glBindVertexArray(buffer.vao);
+
+		glBindBuffer(GL_ARRAY_BUFFER, quadVbo);
+		glEnableVertexAttribArray(linkVertI);
+		glVertexAttribPointer(linkVertI, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+
+		buffer.Upload();
+		EnableInstanceAttrib(linkStartI, 2, offsetof(Instance, start));
+		EnableInstanceAttrib(linkEndI, 2, offsetof(Instance, end));
+		EnableInstanceAttrib(linkColorI, 4, offsetof(Instance, color));
+	}
+	else
+	{
+		glBindVertexArray(buffer.vao);
+		buffer.Upload();
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glUseProgram(linkShader.Object());
+	GLfloat scale[2] = {2.f / Screen::Width(), -2.f / Screen::Height()};
+	glUniform2fv(linkScaleI, 1, scale);
+	glUniform2f(linkCenterI, center.X(), center.Y());
+	glUniform1f(linkZoomI, zoom);
+	glUniform1f(linkWidthI, width);
+	glUniform1f(linkGapI, gap);
+
+	DrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, buffer.instances.size());
+
+	glBindVertexArray(0);
+	glUseProgram(0);
+}
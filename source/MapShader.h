@@ -0,0 +1,92 @@
+// SPDX-License-Identifier: GPL-3.0
+
+#ifndef MAP_SHADER_H_
+#define MAP_SHADER_H_
+
+#include "opengl.h"
+
+#include <cstddef>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+class Color;
+class Point;
+
+
+
+// Class for drawing the rings of the systems and the links between them on the
+// map. Each kind of item is drawn with one instanced draw call, from a buffer that
+// is kept on the GPU between frames, so that only the items that changed need to
+// be uploaded again. The map position and zoom are the only things that change
+// from frame to frame.
+class MapShader {
+public:
+	// The data of a single ring or link. Rings are drawn at the start position,
+	// links from the start to the end position. Positions are in map coordinates.
+	struct Instance {
+		float start[2];
+		float end[2];
+		float color[4];
+	};
+
+	// A list of instances that is kept in a GPU buffer. Every instance belongs to
+	// a key (e.g. the system it is drawn for), and the instances of a key are
+	// updated in place when the key is set again.
+	class Buffer {
+	public:
+		Buffer() noexcept = default;
+		Buffer(const Buffer &) = delete;
+		Buffer &operator=(const Buffer &) = delete;
+		~Buffer();
+
+		// Replaces the instances that belong to the given key.
+		void Set(const void *key, const std::vector<Instance> &instances);
+		void Erase(const void *key);
+		void Clear();
+
+
+	private:
+		// Uploads the instances that changed since the last upload.
+		void Upload();
+
+
+	private:
+		std::vector<Instance> instances;
+		// The indices of the instances that belong to each key.
+		std::unordered_map<const void *, std::vector<std::size_t>> slots;
+		// Instances that don't belong to any key. These are transparent.
+		std::vector<std::size_t> freeSlots;
+		// The range of instances that needs to be uploaded.
+		std::size_t dirtyBegin = std::numeric_limits<std::size_t>::max();
+		std::size_t dirtyEnd = 0;
+
+		GLuint vao = 0;
+		GLuint vbo = 0;
+		// The number of instances that fit into the GPU buffer.
+		std::size_t capacity = 0;
+
+		friend class MapShader;
+	};
+
+
+public:
+	static void Init();
+	// Whether the driver supports instanced rendering. If not, the map needs to
+	// be drawn using the other shaders.
+	static bool IsAvailable();
+
+	static Instance Ring(const Point &position, const Color &color);
+	static Instance Link(const Point &from, const Point &to, const Color &color);
+
+	// Draws every ring in the given buffer. The center is the map position that is
+	// drawn in the center of the screen.
+	static void DrawRings(Buffer &buffer, const Point &center, double zoom, float outer, float inner);
+	// Draws every link in the given buffer, leaving a gap of the given length at
+	// both ends of each link.
+	static void DrawLinks(Buffer &buffer, const Point &center, double zoom, float width, float gap);
+};
+
+
+
+#endif
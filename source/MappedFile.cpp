@@ -0,0 +1,96 @@
+// SPDX-License-Identifier: GPL-3.0
+
+#include "MappedFile.h"
+
+#include "Files.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+
+
+MappedFile::MappedFile(const string &path)
+{
+	Open(path);
+}
+
+
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+
+
+bool MappedFile::Open(const string &path)
+{
+	Close();
+
+#ifndef _WIN32
+	const int file = open(path.c_str(), O_RDONLY);
+	if(file < 0)
+		return false;
+	struct stat info;
+	if(!fstat(file, &info) && info.st_size > 0)
+	{
+		void *mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+		if(mapped != MAP_FAILED)
+		{
+			data = static_cast<const char *>(mapped);
+			size = info.st_size;
+		}
+	}
+	close(file);
+#else
+	if(Files::Exists(path))
+	{
+		contents = Files::Read(path);
+		data = contents.data();
+		size = contents.size();
+	}
+#endif
+	return size;
+}
+
+
+
+void MappedFile::Close()
+{
+#ifndef _WIN32
+	if(data)
+		munmap(const_cast<char *>(data), size);
+#else
+	contents.clear();
+	contents.shrink_to_fit();
+#endif
+	data = nullptr;
+	size = 0;
+}
+
+
+
+const char *MappedFile::Data() const
+{
+	return data;
+}
+
+
+
+size_t MappedFile::Size() const
+{
+	return size;
+}
+
+
+
+string_view MappedFile::View() const
+{
+	return string_view(data, size);
+}
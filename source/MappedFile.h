@@ -0,0 +1,41 @@
+// SPDX-License-Identifier: GPL-3.0
+
+#ifndef MAPPED_FILE_H_
+#define MAPPED_FILE_H_
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+
+
+// Class that maps a file into memory for reading, so that it can be read without
+// copying it first. Platforms without memory mapping read the whole file instead.
+class MappedFile {
+public:
+	MappedFile() noexcept = default;
+	explicit MappedFile(const std::string &path);
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+	~MappedFile();
+
+	// Maps the given file, unmapping the previous one. Returns false if the file
+	// doesn't exist or is empty.
+	bool Open(const std::string &path);
+	void Close();
+
+	const char *Data() const;
+	std::size_t Size() const;
+	std::string_view View() const;
+
+
+private:
+	const char *data = nullptr;
+	std::size_t size = 0;
+	// The contents of the file, if it couldn't be mapped.
+	std::string contents;
+};
+
+
+
+#endif
@@ -33,6 +33,7 @@
 
 #include <cassert>
 #include <map>
+#include <unordered_set>
 
 using namespace std;
 
@@ -247,6 +248,14 @@ const array<string_view, 182> &OutfitEditor::AttributesOrder()
 
 
 
+bool OutfitEditor::IsOrderedAttribute(string_view attribute)
+{
+	static const unordered_set<string_view> attributes(ATTRIBUTE_ORDER.begin(), ATTRIBUTE_ORDER.end());
+	return attributes.count(attribute);
+}
+
+
+
 OutfitEditor::OutfitEditor(Editor &editor, bool &show) noexcept
 	: TemplateEditor<Outfit>(editor, show)
 {
@@ -283,6 +292,7 @@ void OutfitEditor::Render()
 			{
 				editor.GetPlugin().Remove(object);
 				editor.Universe().outfits.Erase(object->trueName);
+				ImGui::InvalidateComboSearch();
 				object = nullptr;
 			}
 			ImGui::EndMenu();
@@ -326,6 +336,7 @@ void OutfitEditor::Render()
 					return;
 
 				auto *newOutfit = editor.Universe().outfits.Get(name);
+				ImGui::InvalidateComboSearch();
 				newOutfit->trueName = name;
 				newOutfit->isDefined = true;
 				object = newOutfit;
@@ -340,7 +351,7 @@ void OutfitEditor::Render()
 				editor.Universe().outfits.Rename(object->trueName, name);
 				object->trueName = name;
 				editor.OutfitterPanel()->UpdateCache();
-				SetDirty();
+				SetRenamed();
 			});
 	ImGui::BeginSimpleCloneModal("Clone Outfit", [this](const string &name)
 			{
@@ -348,6 +359,7 @@ void OutfitEditor::Render()
 					return;
 
 				auto *clone = editor.Universe().outfits.Get(name);
+				ImGui::InvalidateComboSearch();
 				*clone = *object;
 				object = clone;
 
@@ -401,21 +413,25 @@ void OutfitEditor::RenderOutfit()
 	if(object->flotsamSprite)
 		str = object->flotsamSprite->Name();
 	static Sprite *flotsamSprite = nullptr;
+	ImGui::BeginDisabled(!editor.AssetsLoaded());
 	if(ImGui::InputCombo("flotsam sprite", &str, &flotsamSprite, editor.Sprites()))
 	{
 		object->flotsamSprite = flotsamSprite;
 		SetDirty();
 	}
+	ImGui::EndDisabled();
 
 	str.clear();
 	if(object->thumbnail)
 		str = object->thumbnail->Name();
 	static Sprite *thumbnailSprite = nullptr;
+	ImGui::BeginDisabled(!editor.AssetsLoaded());
 	if(ImGui::InputCombo("thumbnail", &str, &thumbnailSprite, editor.Sprites()))
 	{
 		object->thumbnail = thumbnailSprite;
 		SetDirty();
 	}
+	ImGui::EndDisabled();
 
 	if(ImGui::InputTextMultiline("description", &object->description))
 		SetDirty();
@@ -580,12 +596,14 @@ void OutfitEditor::RenderOutfit()
 				static string value;
 				if(object->sound)
 					value = object->sound->Name();
+				ImGui::BeginDisabled(!editor.AssetsLoaded());
 				if(ImGui::InputCombo("sound", &value, &object->sound, editor.Sounds()))
 				{
 					if(!value.empty())
 						object->isWeapon = true;
 					SetDirty();
 				}
+				ImGui::EndDisabled();
 				if(ImGui::TreeNode("ammo"))
 				{
 					value.clear();
@@ -605,12 +623,14 @@ void OutfitEditor::RenderOutfit()
 				if(object->icon)
 					value = object->icon->Name();
 				static Sprite *iconSprite = nullptr;
+				ImGui::BeginDisabled(!editor.AssetsLoaded());
 				if(ImGui::InputCombo("icon", &value, &iconSprite, editor.Sprites()))
 				{
 					object->icon = iconSprite;
 					object->isWeapon = true;
 					SetDirty();
 				}
+				ImGui::EndDisabled();
 				RenderEffect("fire effect", object->fireEffects);
 				RenderEffect("live effect", object->liveEffects);
 				RenderEffect("hit effect", object->hitEffects);
@@ -1103,8 +1123,7 @@ void OutfitEditor::WriteToFile(DataWriter &writer, const Outfit *outfit) const
 					writer.WriteQuoted(attribute.data(), val);
 		// And unsorted attributes get put in the end.
 		for(auto it = outfit->attributes.begin(); it != outfit->attributes.end(); ++it)
-			if(auto ait = find(AttributesOrder().begin(), AttributesOrder().end(), it->first);
-					ait == AttributesOrder().end())
+			if(!IsOrderedAttribute(it->first))
 				if(!diff || !Count(diff->attributes.AsBase(), *it))
 					writer.WriteQuoted(it->first, it->second);
 	}
@@ -21,6 +21,8 @@ class Editor;
 class OutfitEditor : public TemplateEditor<Outfit> {
 public:
 	static const std::array<std::string_view, 182> &AttributesOrder();
+	// Whether the given attribute is part of AttributesOrder().
+	static bool IsOrderedAttribute(std::string_view attribute);
 
 
 
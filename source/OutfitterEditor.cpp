@@ -72,6 +72,7 @@ void OutfitterEditor::Render()
 			{
 				editor.GetPlugin().Remove(object);
 				editor.Universe().outfitSales.Erase(object->name);
+				ImGui::InvalidateComboSearch();
 				object = nullptr;
 			}
 			ImGui::EndMenu();
@@ -91,6 +92,7 @@ void OutfitterEditor::Render()
 					return;
 
 				auto *newOutfitter = editor.Universe().outfitSales.Get(name);
+				ImGui::InvalidateComboSearch();
 				newOutfitter->name = name;
 				object = newOutfitter;
 				SetDirty();
@@ -102,7 +104,7 @@ void OutfitterEditor::Render()
 
 				editor.Universe().outfitSales.Rename(object->name, name);
 				object->name = name;
-				SetDirty();
+				SetRenamed();
 			});
 	ImGui::BeginSimpleCloneModal("Clone Outfitter", [this](const string &name)
 			{
@@ -110,6 +112,7 @@ void OutfitterEditor::Render()
 					return;
 
 				auto *clone = editor.Universe().outfitSales.Get(name);
+				ImGui::InvalidateComboSearch();
 				*clone = *object;
 				object = clone;
 
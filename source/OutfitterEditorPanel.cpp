@@ -149,6 +149,10 @@ void OutfitterEditorPanel::Draw()
 	zones.clear();
 	categoryZones.clear();
 
+	// The outfitter is drawn using sprites that may not be in their set yet.
+	if(!editor.AssetsLoaded())
+		return;
+
 	DrawShipsSidebar();
 	DrawDetailsSidebar();
 	DrawButtons();
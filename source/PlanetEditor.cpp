@@ -79,6 +79,7 @@ void PlanetEditor::Render()
 			{
 				editor.GetPlugin().Remove(object);
 				editor.Universe().planets.Erase(object->name);
+				ImGui::InvalidateComboSearch();
 				object = nullptr;
 			}
 			ImGui::EndMenu();
@@ -98,6 +99,7 @@ void PlanetEditor::Render()
 					return;
 
 				auto *newPlanet = editor.Universe().planets.Get(name);
+				ImGui::InvalidateComboSearch();
 				newPlanet->name = name;
 				newPlanet->isDefined = true;
 				object = newPlanet;
@@ -120,7 +122,7 @@ void PlanetEditor::Render()
 
 				editor.Universe().planets.Rename(object->name, name);
 				object->name = name;
-				SetDirty();
+				SetRenamed();
 			});
 	ImGui::BeginSimpleCloneModal("Clone Planet", [this](const string &name)
 			{
@@ -128,6 +130,7 @@ void PlanetEditor::Render()
 					return;
 
 				auto *clone = editor.Universe().planets.Get(name);
+				ImGui::InvalidateComboSearch();
 				*clone = *object;
 				object = clone;
 
@@ -385,9 +388,11 @@ void PlanetEditor::RenderPlanet()
 	string landscapeName;
 	if(object->landscape)
 		landscapeName = object->landscape->Name();
+	ImGui::BeginDisabled(!editor.AssetsLoaded());
 	if(ImGui::InputCombo("landscape", &landscapeName, &object->landscape, editor.Sprites(),
 				[](const string &name) { return !name.compare(0, 5, "land/"); }))
 		SetDirty();
+	ImGui::EndDisabled();
 	if(ImGui::InputText("music", &object->music, ImGuiInputTextFlags_EnterReturnsTrue))
 		SetDirty();
 
@@ -435,15 +440,12 @@ void PlanetEditor::WriteToFile(DataWriter &writer, const Planet *planet) const
 	writer.Write("planet", planet->TrueName());
 	writer.BeginChild();
 
-	auto planetAttributes = planet->attributes;
-	auto diffAttributes = diff ? diff->attributes : planet->attributes;
-	planetAttributes.erase("spaceport");
-	planetAttributes.erase("shipyard");
-	planetAttributes.erase("outfitter");
-	diffAttributes.erase("spaceport");
-	diffAttributes.erase("shipyard");
-	diffAttributes.erase("outfitter");
-	WriteDiff(writer, "attributes", planetAttributes, diff ? &diffAttributes : nullptr, true);
+	// These attributes are added automatically by the game.
+	WriteDiffIf(writer, "attributes", planet->attributes, diff ? &diff->attributes : nullptr,
+			[](const string &attribute)
+			{
+				return attribute != "spaceport" && attribute != "shipyard" && attribute != "outfitter";
+			}, true);
 
 	if((!diff || planet->landscape != diff->landscape) && planet->landscape)
 		writer.Write("landscape", planet->landscape->Name());
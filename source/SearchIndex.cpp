@@ -0,0 +1,118 @@
+// SPDX-License-Identifier: GPL-3.0
+
+#include "SearchIndex.h"
+
+#include <rapidfuzz/fuzz.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+using namespace std;
+
+namespace {
+	string ToLower(string str)
+	{
+		for(char &c : str)
+			c = tolower(static_cast<unsigned char>(c));
+		return str;
+	}
+
+	// Calls f with every trigram of the given lowercase string.
+	template <typename F>
+	void ForEachTrigram(const string &str, F &&f)
+	{
+		auto byte = [](char c) { return static_cast<uint32_t>(static_cast<unsigned char>(c)); };
+		for(size_t i = 2; i < str.size(); ++i)
+			f(byte(str[i - 2]) << 16 | byte(str[i - 1]) << 8 | byte(str[i]));
+	}
+}
+
+
+
+void SearchIndex::Build(vector<string> names)
+{
+	this->names = std::move(names);
+	lowerNames.clear();
+	lowerNames.reserve(this->names.size());
+	for(const string &name : this->names)
+		lowerNames.push_back(ToLower(name));
+	trigrams.clear();
+
+	for(size_t i = 0; i < lowerNames.size(); ++i)
+		ForEachTrigram(lowerNames[i], [this, i](uint32_t trigram)
+			{
+				// A name can contain the same trigram more than once.
+				auto &list = trigrams[trigram];
+				if(list.empty() || list.back() != i)
+					list.push_back(i);
+			});
+}
+
+
+
+const vector<string> &SearchIndex::Names() const
+{
+	return names;
+}
+
+
+
+vector<SearchIndex::Match> SearchIndex::Search(const string &text, size_t limit,
+		const function<bool(size_t)> &filter) const
+{
+	const string query = ToLower(text);
+	// Queries that are too short to have a trigram are compared to every name.
+	vector<uint32_t> candidates;
+	if(query.size() < 3)
+	{
+		candidates.resize(names.size());
+		for(size_t i = 0; i < names.size(); ++i)
+			candidates[i] = i;
+	}
+	else
+	{
+		vector<bool> isCandidate(names.size());
+		ForEachTrigram(query, [this, &candidates, &isCandidate](uint32_t trigram)
+			{
+				auto it = trigrams.find(trigram);
+				if(it == trigrams.end())
+					return;
+				for(uint32_t index : it->second)
+					if(!isCandidate[index])
+					{
+						isCandidate[index] = true;
+						candidates.push_back(index);
+					}
+			});
+	}
+
+	vector<Match> matches;
+	rapidfuzz::fuzz::CachedPartialRatio<char> scorer(query);
+	const double scoreCutoff = .75;
+	for(uint32_t index : candidates)
+	{
+		if(filter && !filter(index))
+			continue;
+
+		const double score = scorer.similarity(lowerNames[index], scoreCutoff);
+		if(score > scoreCutoff)
+			matches.push_back({score, index});
+	}
+
+	// Only the best matches need to be sorted.
+	auto compare = [this](const Match &lhs, const Match &rhs)
+	{
+		if(lhs.score == rhs.score)
+			return strcmp(names[lhs.index].c_str(), names[rhs.index].c_str()) < 0;
+		return lhs.score > rhs.score;
+	};
+	if(matches.size() > limit)
+	{
+		partial_sort(matches.begin(), matches.begin() + limit, matches.end(), compare);
+		matches.resize(limit);
+	}
+	else
+		sort(matches.begin(), matches.end(), compare);
+	return matches;
+}
@@ -0,0 +1,48 @@
+// SPDX-License-Identifier: GPL-3.0
+
+#ifndef SEARCH_INDEX_H_
+#define SEARCH_INDEX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+
+// Class that fuzzy searches a list of names. Only the names that share a trigram
+// with the query are scored, so a search doesn't need to look at every name.
+class SearchIndex {
+public:
+	struct Match {
+		double score;
+		std::size_t index;
+	};
+
+
+public:
+	// Replaces the names in this index. The names keep the given order.
+	void Build(std::vector<std::string> names);
+
+	const std::vector<std::string> &Names() const;
+
+	// Returns at most "limit" of the names that best match the given query, best
+	// first, ignoring case. Matches with the same score are sorted alphabetically. Names for
+	// which the filter returns false are skipped.
+	std::vector<Match> Search(const std::string &query, std::size_t limit,
+		const std::function<bool(std::size_t)> &filter = {}) const;
+
+
+private:
+	std::vector<std::string> names;
+	// The names in lowercase, which are the ones that are scored.
+	std::vector<std::string> lowerNames;
+	// The names containing each (lowercase) trigram.
+	std::unordered_map<uint32_t, std::vector<uint32_t>> trigrams;
+};
+
+
+
+#endif
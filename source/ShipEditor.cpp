@@ -75,6 +75,7 @@ void ShipEditor::Render()
 			{
 				editor.GetPlugin().Remove(object);
 				editor.Universe().ships.Erase(object->TrueName());
+				ImGui::InvalidateComboSearch();
 				object = nullptr;
 			}
 			ImGui::EndMenu();
@@ -117,6 +118,7 @@ void ShipEditor::Render()
 					return;
 
 				auto *newShip = editor.Universe().ships.Get(name);
+				ImGui::InvalidateComboSearch();
 				newShip->modelName = name;
 				newShip->isDefined = true;
 				object = newShip;
@@ -132,7 +134,7 @@ void ShipEditor::Render()
 					object->variantName = name;
 				else
 					object->modelName = name;
-				SetDirty();
+				SetRenamed();
 			});
 	ImGui::BeginSimpleCloneModal("Clone Model", [this](const string &name)
 			{
@@ -140,6 +142,7 @@ void ShipEditor::Render()
 					return;
 
 				auto *clone = editor.Universe().ships.Get(name);
+				ImGui::InvalidateComboSearch();
 				*clone = *object;
 				object = clone;
 				object->modelName = name;
@@ -148,6 +151,7 @@ void ShipEditor::Render()
 	ImGui::BeginSimpleCloneModal("Clone Variant", [this](const string &name)
 			{
 				auto *clone = editor.Universe().ships.Get(name);
+				ImGui::InvalidateComboSearch();
 				*clone = *object;
 				object = clone;
 				object->variantName = name;
@@ -194,11 +198,13 @@ void ShipEditor::RenderShip()
 	if(object->thumbnail)
 		thumbnail = object->thumbnail->Name();
 	static Sprite *thumbnailSprite = nullptr;
+	ImGui::BeginDisabled(!editor.AssetsLoaded());
 	if(ImGui::InputCombo("thumbnail", &thumbnail, &thumbnailSprite, editor.Sprites()))
 	{
 		object->thumbnail = thumbnailSprite;
 		SetDirty();
 	}
+	ImGui::EndDisabled();
 	if(ImGui::Checkbox("never disabled", &object->neverDisabled))
 		SetDirty();
 	bool uncapturable = !object->isCapturable;
@@ -1016,25 +1022,25 @@ void ShipEditor::WriteToFile(DataWriter &writer, const Ship *ship) const
 					writer.Write("hyperdrive out sound", it.first->Name());
 				}
 
-	auto shipAttributes = ship->baseAttributes.Attributes();
-	auto diffAttributes = diff ? diff->baseAttributes.Attributes() : shipAttributes;
-	shipAttributes.Remove("gun ports");
-	shipAttributes.Remove("turret mounts");
-	diffAttributes.Remove("gun ports");
-	diffAttributes.Remove("turret mounts");
+	// The number of hardpoints is saved as part of the hardpoints themselves.
+	auto isHardpointCount = [](string_view attribute)
+	{
+		return attribute == "gun ports" || attribute == "turret mounts";
+	};
+	const auto &shipAttributes = ship->baseAttributes.Attributes();
+	const auto &diffAttributes = diff ? diff->baseAttributes.Attributes() : shipAttributes;
 
 	if(!diff || shipAttributes.AsBase() != diffAttributes.AsBase())
 	{
 		// Write the known attributes first.
 		for(string_view attribute : OutfitEditor::AttributesOrder())
-			if(auto val = shipAttributes.Get(attribute.data()))
+			if(auto val = shipAttributes.Get(attribute.data()); val && !isHardpointCount(attribute))
 				if(!diff || !Count(diffAttributes.AsBase(), make_pair(attribute.data(), val)))
 					writer.WriteQuoted(attribute.data(), val);
 
 		// And unsorted attributes get put in the end.
 		for(auto it = shipAttributes.begin(); it != shipAttributes.end(); ++it)
-			if(auto ait = find(OutfitEditor::AttributesOrder().begin(), OutfitEditor::AttributesOrder().end(), it->first);
-					ait == OutfitEditor::AttributesOrder().end())
+			if(!OutfitEditor::IsOrderedAttribute(it->first) && !isHardpointCount(it->first))
 				if(!diff || !Count(diffAttributes.AsBase(), *it))
 				{
 					writeAttributes();
@@ -72,6 +72,7 @@ void ShipyardEditor::Render()
 			{
 				editor.GetPlugin().Remove(object);
 				editor.Universe().shipSales.Erase(object->name);
+				ImGui::InvalidateComboSearch();
 				object = nullptr;
 			}
 			ImGui::EndMenu();
@@ -91,6 +92,7 @@ void ShipyardEditor::Render()
 					return;
 
 				auto *newShipyard = editor.Universe().shipSales.Get(name);
+				ImGui::InvalidateComboSearch();
 				newShipyard->name = name;
 				object = newShipyard;
 				SetDirty();
@@ -102,7 +104,7 @@ void ShipyardEditor::Render()
 
 				editor.Universe().shipSales.Rename(object->name, name);
 				object->name = name;
-				SetDirty();
+				SetRenamed();
 			});
 	ImGui::BeginSimpleCloneModal("Clone Shipyard", [this](const string &name)
 			{
@@ -110,6 +112,7 @@ void ShipyardEditor::Render()
 					return;
 
 				auto *clone = editor.Universe().shipSales.Get(name);
+				ImGui::InvalidateComboSearch();
 				*clone = *object;
 				object = clone;
 
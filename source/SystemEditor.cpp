@@ -120,6 +120,7 @@ SystemEditor::SystemEditor(Editor &editor, bool &show) noexcept
 void SystemEditor::UpdateSystemPosition(const System *system, Point dp)
 {
 	const_cast<System *>(system)->position += dp;
+	editor.MapPanel()->UpdateSystem(system);
 	SetDirty(system);
 }
 
@@ -144,7 +145,8 @@ void SystemEditor::ToggleLink(const System *system)
 		object->Unlink(const_cast<System *>(system));
 	else
 		object->Link(const_cast<System *>(system));
-	UpdateMap();
+	editor.MapPanel()->UpdateLinks(object);
+	editor.MapPanel()->UpdateLinks(system);
 	SetDirty();
 	SetDirty(system);
 }
@@ -226,7 +228,9 @@ void SystemEditor::Render()
 		return;
 	}
 
-	if(ImGui::IsWindowFocused() && ImGui::GetIO().KeyCtrl && ImGui::IsKeyPressed(ImGuiKey_R))
+	// Randomizing the stellars picks from the sprites, which may still be loading.
+	const bool canRandomize = object && editor.AssetsLoaded();
+	if(canRandomize && ImGui::IsWindowFocused() && ImGui::GetIO().KeyCtrl && ImGui::IsKeyPressed(ImGuiKey_R))
 		RandomizeAll();
 	if(ImGui::IsWindowFocused() && ImGui::GetIO().KeyCtrl && ImGui::IsKeyPressed(ImGuiKey_T))
 		GenerateTrades();
@@ -275,14 +279,14 @@ void SystemEditor::Render()
 		}
 		if(ImGui::BeginMenu("Randomize"))
 		{
-			if(ImGui::MenuItem("Randomize Stellars", nullptr, false, object))
+			if(ImGui::MenuItem("Randomize Stellars", nullptr, false, canRandomize))
 				Randomize();
 			if(ImGui::MenuItem("Randomize Asteroids", nullptr, false, object))
 				RandomizeAsteroids();
 			if(ImGui::MenuItem("Randomize Minables", nullptr, false, object))
 				RandomizeMinables();
 			ImGui::Separator();
-			if(ImGui::MenuItem("Randomize All", "Ctrl+R", false, object))
+			if(ImGui::MenuItem("Randomize All", "Ctrl+R", false, canRandomize))
 				RandomizeAll();
 			ImGui::EndMenu();
 		}
@@ -308,7 +312,7 @@ void SystemEditor::Render()
 				editor.Universe().systems.Rename(object->name, name);
 				object->name = name;
 				UpdateMap();
-				SetDirty();
+				SetRenamed();
 			});
 
 	if(editor.GetUI().Top() == editor.MapPanel())
@@ -345,6 +349,7 @@ void SystemEditor::AlwaysRender(bool showNewSystem, bool showCloneSystem)
 					return;
 
 				auto *newSystem = editor.Universe().systems.Get(name);
+				ImGui::InvalidateComboSearch();
 
 				newSystem->name = name;
 				newSystem->position = createNewSystem ? position : object->position + Point(25., 25.);
@@ -352,7 +357,8 @@ void SystemEditor::AlwaysRender(bool showNewSystem, bool showCloneSystem)
 				newSystem->isDefined = true;
 				newSystem->hasPosition = true;
 				object = newSystem;
-				UpdateMap();
+				editor.MapPanel()->UpdateSystem(object);
+				editor.MapPanel()->UpdateLinks(object);
 				SetDirty();
 				editor.MapPanel()->Select(object);
 				editor.SystemViewPanel()->Select(object);
@@ -367,6 +373,7 @@ void SystemEditor::AlwaysRender(bool showNewSystem, bool showCloneSystem)
 					return;
 
 				auto *clone = editor.Universe().systems.Get(name);
+				ImGui::InvalidateComboSearch();
 				*clone = *object;
 				object = clone;
 
@@ -375,7 +382,8 @@ void SystemEditor::AlwaysRender(bool showNewSystem, bool showCloneSystem)
 				object->objects.clear();
 				object->links.clear();
 				object->attributes.insert("uninhabited");
-				UpdateMap();
+				editor.MapPanel()->UpdateSystem(object);
+				editor.MapPanel()->UpdateLinks(object);
 				SetDirty();
 				editor.MapPanel()->Select(object);
 				editor.SystemViewPanel()->Select(object);
@@ -397,7 +405,7 @@ void SystemEditor::RenderSystem()
 	if(ImGui::InputDouble2Ex("pos", pos))
 	{
 		object->position.Set(pos[0], pos[1]);
-		UpdateMap();
+		editor.MapPanel()->UpdateSystem(object);
 		SetDirty();
 	}
 
@@ -407,7 +415,7 @@ void SystemEditor::RenderSystem()
 		if(ImGui::InputCombo("government", &govName, &selected, editor.Universe().governments))
 		{
 			object->government = selected;
-			UpdateMap();
+			editor.MapPanel()->UpdateSystem(object);
 			SetDirty();
 		}
 	}
@@ -425,12 +433,14 @@ void SystemEditor::RenderSystem()
 	if(object->jumpRange < 0.)
 		object->jumpRange = 0.;
 	string enterHaze = object->haze ? object->haze->Name() : "";
+	ImGui::BeginDisabled(!editor.AssetsLoaded());
 	if(ImGui::InputCombo("haze", &enterHaze, &object->haze, editor.Sprites(),
 				[](const string &name) { return !name.compare(0, 10, "_menu/haze"); }))
 	{
 		UpdateMain();
 		SetDirty();
 	}
+	ImGui::EndDisabled();
 
 	double arrival[2] = {object->extraHyperArrivalDistance, object->extraJumpArrivalDistance};
 	if(ImGui::InputDouble2Ex("arrival", arrival))
@@ -528,7 +538,9 @@ void SystemEditor::RenderSystem()
 		if(!toAdd.empty() || !toRemove.empty())
 		{
 			SetDirty();
-			UpdateMap();
+			editor.MapPanel()->UpdateLinks(object);
+			for(auto &&sys : toRemove)
+				editor.MapPanel()->UpdateLinks(sys);
 		}
 		ImGui::TreePop();
 	}
@@ -769,7 +781,7 @@ void SystemEditor::RenderSystem()
 					object->trade.erase(it);
 				else if(value)
 					object->trade[commodity.name].SetBase(value);
-				editor.MapPanel()->UpdateCache();
+				editor.MapPanel()->UpdateLinks(object);
 				SetDirty();
 			}
 			ImGui::PopID();
@@ -1097,11 +1109,8 @@ void SystemEditor::WriteToFile(DataWriter &writer, const System *system) const
 			writer.Write("remove", "government");
 	}
 
-	auto systemAttributes = system->attributes;
-	auto diffAttributes = diff ? diff->attributes : system->attributes;
-	systemAttributes.erase("uninhabited");
-	diffAttributes.erase("uninhabited");
-	WriteDiff(writer, "attributes", systemAttributes, diff ? &diffAttributes : nullptr, true);
+	WriteDiffIf(writer, "attributes", system->attributes, diff ? &diff->attributes : nullptr,
+			[](const string &attribute) { return attribute != "uninhabited"; }, true);
 
 	if(!diff || system->music != diff->music)
 	{
@@ -1130,13 +1139,13 @@ void SystemEditor::WriteToFile(DataWriter &writer, const System *system) const
 	if((!diff && system->habitable != 1000.) || (diff && system->habitable != diff->habitable))
 		writer.Write("habitable", system->habitable);
 
-	auto belts = system->belts;
-	if(belts.size() == 1 && belts.back() == 1500)
-		belts.eraseAt(belts.begin());
-	auto diffBelts = diff ? diff->belts : system->belts;
-	if(diffBelts.size() == 1 && diffBelts.back() == 1500)
-		diffBelts.eraseAt(diffBelts.begin());
-	WriteDiff(writer, "belt", belts, diff ? &diffBelts : nullptr);
+	// A single belt at the default distance is the same as no belts at all.
+	static const decltype(system->belts) noBelts;
+	auto beltsFor = [](const System *system) -> const decltype(system->belts) &
+	{
+		return system->belts.size() == 1 && system->belts.back() == 1500 ? noBelts : system->belts;
+	};
+	WriteDiff(writer, "belt", beltsFor(system), diff ? &beltsFor(diff) : nullptr);
 
 	if((!diff && system->jumpRange) || (diff && system->jumpRange != diff->jumpRange))
 		writer.Write("jump range", system->jumpRange);
@@ -1151,23 +1160,15 @@ void SystemEditor::WriteToFile(DataWriter &writer, const System *system) const
 
 	WriteDiff(writer, "link", system->links, diff ? &diff->links : nullptr, false, true, false, true);
 
-	auto asteroids = system->asteroids;
-	asteroids.erase(std::remove_if(asteroids.begin(), asteroids.end(), [](const System::Asteroid &a) { return a.Type(); }), asteroids.end());
-	auto minables = system->asteroids;
-	minables.erase(std::remove_if(minables.begin(), minables.end(), [](const System::Asteroid &a) { return !a.Type(); }), minables.end());
-	auto diffAsteroids = diff ? diff->asteroids : system->asteroids;
-	diffAsteroids.erase(std::remove_if(diffAsteroids.begin(), diffAsteroids.end(), [](const System::Asteroid &a) { return a.Type(); }), diffAsteroids.end());
-	auto diffMinables = diff ? diff->asteroids : system->asteroids;
-	diffMinables.erase(std::remove_if(diffMinables.begin(), diffMinables.end(), [](const System::Asteroid &a) { return !a.Type(); }), diffMinables.end());
-	WriteDiff(writer, "asteroids", asteroids, diff ? &diffAsteroids : nullptr);
-	WriteDiff(writer, "minables", minables, diff ? &diffMinables : nullptr);
+	WriteDiffIf(writer, "asteroids", system->asteroids, diff ? &diff->asteroids : nullptr,
+			[](const System::Asteroid &a) { return !a.Type(); });
+	WriteDiffIf(writer, "minables", system->asteroids, diff ? &diff->asteroids : nullptr,
+			[](const System::Asteroid &a) { return a.Type(); });
 
 	if(!diff || system->trade != diff->trade)
 	{
-		auto trades = system->trade;
+		bool hasRemoved = false;
 		if(diff)
-		{
-			bool hasRemoved = false;
 			for(auto it = diff->trade.begin(); it != diff->trade.end(); ++it)
 				if(system->trade.find(it->first) == system->trade.end())
 				{
@@ -1175,20 +1176,18 @@ void SystemEditor::WriteToFile(DataWriter &writer, const System *system) const
 					hasRemoved = true;
 					break;
 				}
-			if(!hasRemoved)
-				for(auto it = trades.begin(); it != trades.end();)
-				{
-					auto jt = diff->trade.find(it->first);
-					if(jt != diff->trade.end() && jt->second == it->second)
-						it = trades.erase(it);
-					else
-						++it;
-				}
-		}
 
-		if(!trades.empty())
-			for(auto &&trade : trades)
-				writer.Write("trade", trade.first, trade.second.base);
+		// Unless every price was removed, only the prices that changed need to be written.
+		for(auto &&trade : system->trade)
+		{
+			if(diff && !hasRemoved)
+			{
+				auto it = diff->trade.find(trade.first);
+				if(it != diff->trade.end() && it->second == trade.second)
+					continue;
+			}
+			writer.Write("trade", trade.first, trade.second.base);
+		}
 	}
 	WriteDiff(writer, "fleet", system->fleets, diff ? &diff->fleets : nullptr);
 	WriteDiff(writer, "hazard", system->hazards, diff ? &diff->hazards : nullptr);
@@ -1661,6 +1660,7 @@ void SystemEditor::GenerateTrades()
 		object->trade[commodity.name].SetBase(rand(gen));
 	}
 
+	editor.MapPanel()->UpdateLinks(object);
 	SetDirty();
 }
 
@@ -1719,7 +1719,9 @@ void SystemEditor::Delete(const System *system, bool safe)
 
 	auto oldNeighbors = system->VisibleNeighbors();
 	editor.GetPlugin().Remove(system);
+	editor.MapPanel()->RemoveSystem(system);
 	editor.Universe().systems.Erase(system->name);
+	ImGui::InvalidateComboSearch();
 
 	auto newSystem = oldLinks.empty() ?
 		oldNeighbors.empty() ? nullptr : *oldNeighbors.begin()
@@ -0,0 +1,144 @@
+// SPDX-License-Identifier: GPL-3.0
+
+#include "SystemGrid.h"
+
+#include "Rectangle.h"
+#include "System.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+namespace {
+	// The size of each cell of the grid. Systems are usually a few dozen units
+	// apart, so a cell holds a handful of them.
+	constexpr double CELL_SIZE = 64.;
+
+	int32_t CellCoordinate(double value)
+	{
+		return static_cast<int32_t>(floor(value / CELL_SIZE));
+	}
+
+	uint64_t CellKey(int32_t x, int32_t y)
+	{
+		return static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32 | static_cast<uint32_t>(y);
+	}
+
+	uint64_t CellFor(const Point &point)
+	{
+		return CellKey(CellCoordinate(point.X()), CellCoordinate(point.Y()));
+	}
+}
+
+
+
+void SystemGrid::Clear()
+{
+	cells.clear();
+	cellOf.clear();
+}
+
+
+
+void SystemGrid::Update(const System *system)
+{
+	const uint64_t cell = CellFor(system->Position());
+	auto it = cellOf.find(system);
+	if(it != cellOf.end())
+	{
+		if(it->second == cell)
+			return;
+		Remove(system);
+	}
+
+	cells[cell].push_back(system);
+	cellOf[system] = cell;
+}
+
+
+
+void SystemGrid::Remove(const System *system)
+{
+	auto it = cellOf.find(system);
+	if(it == cellOf.end())
+		return;
+
+	auto cell = cells.find(it->second);
+	auto &systems = cell->second;
+	systems.erase(find(systems.begin(), systems.end(), system));
+	if(systems.empty())
+		cells.erase(cell);
+	cellOf.erase(it);
+}
+
+
+
+size_t SystemGrid::Size() const
+{
+	return cellOf.size();
+}
+
+
+
+vector<const System *> SystemGrid::Near(const Point &point, double distance) const
+{
+	vector<const System *> result;
+	ForEachIn(point - Point(distance, distance), point + Point(distance, distance),
+		[&result, &point, distance](const System *system)
+		{
+			if(point.Distance(system->Position()) < distance)
+				result.push_back(system);
+		});
+	sort(result.begin(), result.end(), [&point](const System *lhs, const System *rhs)
+		{
+			return point.Distance(lhs->Position()) < point.Distance(rhs->Position());
+		});
+	return result;
+}
+
+
+
+vector<const System *> SystemGrid::Inside(const Rectangle &rect) const
+{
+	vector<const System *> result;
+	ForEachIn(Point(rect.Left(), rect.Top()), Point(rect.Right(), rect.Bottom()),
+		[&result, &rect](const System *system)
+		{
+			if(rect.Contains(system->Position()))
+				result.push_back(system);
+		});
+	return result;
+}
+
+
+
+template <typename F>
+void SystemGrid::ForEachIn(const Point &topLeft, const Point &bottomRight, F &&f) const
+{
+	const int32_t left = CellCoordinate(min(topLeft.X(), bottomRight.X()));
+	const int32_t top = CellCoordinate(min(topLeft.Y(), bottomRight.Y()));
+	const int32_t right = CellCoordinate(max(topLeft.X(), bottomRight.X()));
+	const int32_t bottom = CellCoordinate(max(topLeft.Y(), bottomRight.Y()));
+
+	// If the area covers more cells than there are cells with systems in them, it is
+	// faster to look at every cell instead.
+	const uint64_t width = static_cast<int64_t>(right) - left + 1;
+	const uint64_t height = static_cast<int64_t>(bottom) - top + 1;
+	if(width * height > cells.size())
+	{
+		for(const auto &cell : cells)
+			for(const System *system : cell.second)
+				f(system);
+		return;
+	}
+
+	for(int32_t x = left; x <= right; ++x)
+		for(int32_t y = top; y <= bottom; ++y)
+		{
+			auto it = cells.find(CellKey(x, y));
+			if(it != cells.end())
+				for(const System *system : it->second)
+					f(system);
+		}
+}
@@ -0,0 +1,53 @@
+// SPDX-License-Identifier: GPL-3.0
+
+#ifndef SYSTEM_GRID_H_
+#define SYSTEM_GRID_H_
+
+#include "Point.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+class Rectangle;
+class System;
+
+
+
+// Class that sorts systems into a uniform grid by their position, so that the
+// systems close to a point or inside an area can be found without looking at
+// every system of the universe.
+class SystemGrid {
+public:
+	// Removes every system from the grid.
+	void Clear();
+	// Adds the given system at its current position, or moves it there if it is
+	// already part of the grid.
+	void Update(const System *system);
+	void Remove(const System *system);
+
+	std::size_t Size() const;
+
+	// Returns the systems that are closer than the given distance to the point,
+	// closest first.
+	std::vector<const System *> Near(const Point &point, double distance) const;
+	// Returns the systems that are inside the given rectangle.
+	std::vector<const System *> Inside(const Rectangle &rect) const;
+
+
+private:
+	// Calls f with every system in the cells overlapping the given area.
+	template <typename F>
+	void ForEachIn(const Point &topLeft, const Point &bottomRight, F &&f) const;
+
+
+private:
+	std::unordered_map<uint64_t, std::vector<const System *>> cells;
+	// The cell each system is in.
+	std::unordered_map<const System *, uint64_t> cellOf;
+};
+
+
+
+#endif
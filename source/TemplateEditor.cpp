@@ -54,6 +54,16 @@ void TemplateEditor<T>::SetDirty(const T *obj)
 
 
 
+template <typename T>
+void TemplateEditor<T>::SetRenamed()
+{
+	editor.GetPlugin().InvalidateCache();
+	ImGui::InvalidateComboSearch();
+	SetDirty();
+}
+
+
+
 template <typename T>
 void TemplateEditor<T>::RenderSprites(const std::string &name, std::vector<std::pair<Body, int>> &map)
 {
@@ -96,8 +106,10 @@ bool TemplateEditor<T>::RenderElement(Body *sprite, const std::string &name, con
 	{
 		if(sprite->GetSprite())
 			spriteName = sprite->GetSprite()->Name();
+		ImGui::BeginDisabled(!editor.AssetsLoaded());
 		if(ImGui::InputCombo("sprite", &spriteName, &sprite->sprite, editor.Sprites(), spriteFilter))
 			SetDirty();
+		ImGui::EndDisabled();
 
 		if(ImGui::InputFloatEx("scale", &sprite->scale))
 			SetDirty();
@@ -157,11 +169,13 @@ void TemplateEditor<T>::RenderSound(const std::string &name, std::map<const Soun
 
 			if(open)
 			{
+				ImGui::BeginDisabled(!editor.AssetsLoaded());
 				if(ImGui::InputCombo("sound", &soundName, &toAdd, editor.Sounds()))
 				{
 					toRemove = it;
 					SetDirty();
 				}
+				ImGui::EndDisabled();
 				if(ImGui::InputInt("count", &it->second))
 				{
 					if(!it->second)
@@ -175,6 +189,7 @@ void TemplateEditor<T>::RenderSound(const std::string &name, std::map<const Soun
 
 		static std::string newSoundName;
 		static const Sound *newSound;
+		ImGui::BeginDisabled(!editor.AssetsLoaded());
 		if(ImGui::InputCombo("new sound", &newSoundName, &newSound, editor.Sounds()))
 			if(!newSoundName.empty())
 			{
@@ -183,6 +198,7 @@ void TemplateEditor<T>::RenderSound(const std::string &name, std::map<const Soun
 				newSound = nullptr;
 				SetDirty();
 			}
+		ImGui::EndDisabled();
 
 		if(toAdd)
 		{
@@ -19,6 +19,7 @@
 #include "imgui_ex.h"
 #include "imgui_stdlib.h"
 
+#include <algorithm>
 #include <functional>
 #include <iomanip>
 #include <list>
@@ -28,6 +29,7 @@
 #include <string>
 #include <string_view>
 #include <type_traits>
+#include <unordered_map>
 #include <vector>
 
 class Editor;
@@ -72,6 +74,9 @@ protected:
 	// Marks the current object as dirty.
 	void SetDirty();
 	void SetDirty(const T *obj);
+	// Marks the current object as renamed. Other objects refer to it by name, so
+	// they can't reuse what was written for them before either.
+	void SetRenamed();
 
 	void RenderSprites(const std::string &name, std::vector<std::pair<Body, int>> &map);
 	bool RenderElement(Body *sprite, const std::string &name, const std::function<bool(const std::string &)> &spriteFilter = {});
@@ -139,6 +144,43 @@ bool Count(const std::vector<T> &container, const T &obj) { return std::find(con
 template <typename T, typename U>
 bool Count(const WeightedList<T> &list, const U &obj) { return std::find(list.begin(), list.end(), obj) != list.end(); }
 
+// Looks up the elements of a list by their name, so that diffing two lists doesn't
+// need to search one list for every element of the other.
+template <typename C>
+class DiffIndex {
+public:
+	explicit DiffIndex(const C &container)
+	{
+		elements.reserve(container.size());
+		for(auto &&it : container)
+			elements.emplace(NameFor(it), &it);
+	}
+
+	template <typename U>
+	bool Count(const U &obj) const
+	{
+		auto range = elements.equal_range(NameFor(obj));
+		return std::any_of(range.first, range.second, [&obj](const auto &it) { return *it.second == obj; });
+	}
+
+
+private:
+	using Element = std::remove_reference_t<decltype(*std::declval<const C &>().begin())>;
+	std::unordered_multimap<std::string, Element *> elements;
+};
+// Sets can already look up their elements quickly.
+template <typename T>
+class DiffIndex<std::set<T>> {
+public:
+	explicit DiffIndex(const std::set<T> &container) : container(container) {}
+
+	bool Count(const T &obj) const { return container.count(obj); }
+
+
+private:
+	const std::set<T> &container;
+};
+
 template <typename T>
 void Insert(std::set<T> &container, const T &obj) { container.insert(obj); }
 template <typename T>
@@ -168,34 +210,42 @@ inline void AdditionalCalls(DataWriter &writer, const WeightedItem<T> &item)
 		writer.WriteToken(item.weight);
 }
 
-template <typename C>
-void WriteDiff(DataWriter &writer, const char *name, const C &orig, const C *diff, bool onOneLine = false, bool allowRemoving = true, bool implicitAdd = false, bool sorted = false)
+// Writes the difference between the given lists, ignoring any elements for which
+// filter returns false.
+template <typename C, typename F>
+void WriteDiffIf(DataWriter &writer, const char *name, const C &orig, const C *diff, const F &filter, bool onOneLine = false, bool allowRemoving = true, bool implicitAdd = false, bool sorted = false)
 {
 	auto writeRaw = onOneLine
-		? [](DataWriter &writer, const char *name, const C &list, bool sorted)
+		? [](DataWriter &writer, const char *name, const C &list, bool sorted, const F &filter)
 		{
 			writer.WriteToken(name);
 			if(sorted)
 				WriteSorted(list, [](const auto *lhs, const auto *rhs) { return NameFor(lhs) < NameFor(rhs); },
-						[&writer](const auto &element)
+						[&writer, &filter](const auto &element)
 						{
+							if(!filter(element))
+								return;
 							writer.WriteToken(NameFor(element));
 							AdditionalCalls(writer, element);
 						});
 			else
 				for(auto &&it : list)
 				{
+					if(!filter(it))
+						continue;
 					writer.WriteToken(NameFor(it));
 					AdditionalCalls(writer, it);
 				}
 			writer.Write();
 		}
-		: [](DataWriter &writer, const char *name, const C &list, bool sorted)
+		: [](DataWriter &writer, const char *name, const C &list, bool sorted, const F &filter)
 		{
 			if(sorted)
 				WriteSorted(list, [](const auto *lhs, const auto *rhs) { return NameFor(lhs) < NameFor(rhs); },
-						[&writer, &name](const auto &element)
+						[&writer, &name, &filter](const auto &element)
 						{
+							if(!filter(element))
+								return;
 							writer.WriteToken(name);
 							writer.WriteToken(NameFor(element));
 							AdditionalCalls(writer, element);
@@ -204,6 +254,8 @@ void WriteDiff(DataWriter &writer, const char *name, const C &orig, const C *dif
 			else
 				for(auto &&it : list)
 				{
+					if(!filter(it))
+						continue;
 					writer.WriteToken(name);
 					writer.WriteToken(NameFor(it));
 					AdditionalCalls(writer, it);
@@ -211,7 +263,7 @@ void WriteDiff(DataWriter &writer, const char *name, const C &orig, const C *dif
 				}
 		};
 	auto writeAdd = onOneLine
-		? [](DataWriter &writer, const char *name, const C &list, bool sorted)
+		? [](DataWriter &writer, const char *name, const C &list, bool sorted, const F &filter)
 		{
 			writer.WriteToken("add");
 			writer.WriteToken(name);
@@ -230,7 +282,7 @@ void WriteDiff(DataWriter &writer, const char *name, const C &orig, const C *dif
 				}
 			writer.Write();
 		}
-		: [](DataWriter &writer, const char *name, const C &list, bool sorted)
+		: [](DataWriter &writer, const char *name, const C &list, bool sorted, const F &filter)
 		{
 			if(sorted)
 				WriteSorted(list, [](const auto *lhs, const auto *rhs) { return NameFor(lhs) < NameFor(rhs); },
@@ -253,7 +305,7 @@ void WriteDiff(DataWriter &writer, const char *name, const C &orig, const C *dif
 				}
 		};
 	auto writeRemove = onOneLine
-		? [](DataWriter &writer, const char *name, const C &list, bool sorted)
+		? [](DataWriter &writer, const char *name, const C &list, bool sorted, const F &filter)
 		{
 			writer.WriteToken("remove");
 			writer.WriteToken(name);
@@ -268,7 +320,7 @@ void WriteDiff(DataWriter &writer, const char *name, const C &orig, const C *dif
 					writer.WriteToken(NameFor(it));
 			writer.Write();
 		}
-		: [](DataWriter &writer, const char *name, const C &list, bool sorted)
+		: [](DataWriter &writer, const char *name, const C &list, bool sorted, const F &filter)
 		{
 			if(sorted)
 				WriteSorted(list, [](const auto *lhs, const auto *rhs) { return NameFor(lhs) < NameFor(rhs); },
@@ -280,47 +332,63 @@ void WriteDiff(DataWriter &writer, const char *name, const C &orig, const C *dif
 				for(auto &&it : list)
 					writer.Write("remove", name, NameFor(it));
 		};
+	const bool isOrigEmpty = std::none_of(orig.begin(), orig.end(), filter);
 	if(!diff)
 	{
-		if(!orig.empty())
-			writeRaw(writer, name, orig, sorted);
+		if(!isOrigEmpty)
+			writeRaw(writer, name, orig, sorted, filter);
 		return;
 	}
 
 	typename std::decay<decltype(orig)>::type toAdd;
 	auto toRemove = toAdd;
 
+	const DiffIndex<C> origIndex(orig);
+	const DiffIndex<C> diffIndex(*diff);
 	for(auto &&it : orig)
-		if(!Count(*diff, it))
+		if(filter(it) && !diffIndex.Count(it))
 			Insert(toAdd, it);
+	size_t diffSize = 0;
 	for(auto &&it : *diff)
-		if(!Count(orig, it))
-			Insert(toRemove, it);
+		if(filter(it))
+		{
+			++diffSize;
+			if(!origIndex.Count(it))
+				Insert(toRemove, it);
+		}
 
 	if(toAdd.empty() && toRemove.empty())
 		return;
 
-	if(toRemove.size() == diff->size() && !diff->empty())
+	if(toRemove.size() == diffSize && diffSize)
 	{
-		if(orig.empty())
+		if(isOrigEmpty)
 			writer.Write("remove", name);
 		else
-			writeRaw(writer, name, toAdd, sorted);
+			writeRaw(writer, name, toAdd, sorted, filter);
 	}
 	else if(allowRemoving)
 	{
 		if(!toAdd.empty())
 		{
 			if(implicitAdd)
-				writeRaw(writer, name, toAdd, sorted);
+				writeRaw(writer, name, toAdd, sorted, filter);
 			else
-				writeAdd(writer, name, toAdd, sorted);
+				writeAdd(writer, name, toAdd, sorted, filter);
 		}
 		if(!toRemove.empty())
-			writeRemove(writer, name, toRemove, sorted);
+			writeRemove(writer, name, toRemove, sorted, filter);
 	}
-	else if(!orig.empty())
-		writeRaw(writer, name, orig, sorted);
+	else if(!isOrigEmpty)
+		writeRaw(writer, name, orig, sorted, filter);
+}
+
+
+
+template <typename C>
+void WriteDiff(DataWriter &writer, const char *name, const C &orig, const C *diff, bool onOneLine = false, bool allowRemoving = true, bool implicitAdd = false, bool sorted = false)
+{
+	WriteDiffIf(writer, name, orig, diff, [](const auto &) { return true; }, onOneLine, allowRemoving, implicitAdd, sorted);
 }
 
 
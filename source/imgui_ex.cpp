@@ -10,6 +10,12 @@
 
 
 
+namespace {
+	unsigned comboSearchGeneration = 0;
+}
+
+
+
 namespace ImGui
 {
 	IMGUI_API bool InputDoubleEx(const char *label, double *v, ImGuiInputTextFlags flags)
@@ -54,6 +60,20 @@ namespace ImGui
 
 
 
+	IMGUI_API void InvalidateComboSearch()
+	{
+		++comboSearchGeneration;
+	}
+
+
+
+	IMGUI_API unsigned ComboSearchGeneration()
+	{
+		return comboSearchGeneration;
+	}
+
+
+
 	IMGUI_API bool InputSwizzle(const char *label, int *swizzle, bool allowNoSwizzle)
 	{
 		constexpr int count = 29;
@@ -5,6 +5,7 @@
 
 #define IMGUI_DEFINE_MATH_OPERATORS
 
+#include "SearchIndex.h"
 #include "Set.h"
 
 #include <imgui.h>
@@ -15,8 +16,10 @@
 #include <algorithm>
 #include <cstdint>
 #include <functional>
+#include <map>
 #include <string>
 #include <type_traits>
+#include <unordered_map>
 #include <vector>
 
 
@@ -35,6 +38,12 @@ namespace ImGui
 	template <typename T>
 	IMGUI_API bool InputCombo(const char *label, std::string *input, const T **element, const Set<T> &elements, std::function<bool(const std::string &)> sort = {});
 
+	// Discards the search indices used by InputCombo. Only a change in the number of
+	// objects is noticed automatically, so this needs to be called whenever an
+	// object is created, renamed or deleted.
+	IMGUI_API void InvalidateComboSearch();
+	IMGUI_API unsigned ComboSearchGeneration();
+
 	IMGUI_API bool InputSwizzle(const char *label, int *swizzle, bool allowNoSwizzle = false);
 
 	template <typename F>
@@ -63,6 +72,40 @@ bool IsValid(const T &obj, decltype(obj.TrueName(), void()) *)
 
 
 
+namespace impl {
+// The search index of a set of objects, shared by every InputCombo using that set.
+struct ComboSearch {
+	SearchIndex index;
+	std::size_t size = 0;
+	unsigned generation = 0;
+	// Incremented every time the index is rebuilt.
+	unsigned builds = 0;
+};
+
+template <typename T>
+const ComboSearch &ComboSearchFor(const Set<T> &elements)
+{
+	static std::map<const Set<T> *, ComboSearch> searches;
+	auto &search = searches[&elements];
+	const std::size_t size = elements.size();
+	if(search.builds && search.size == size && search.generation == ImGui::ComboSearchGeneration())
+		return search;
+
+	// Sets are ordered by name, so the index is sorted alphabetically.
+	std::vector<std::string> names;
+	names.reserve(size);
+	for(const auto &it : elements)
+		names.push_back(it.first);
+	search.index.Build(std::move(names));
+	search.size = size;
+	search.generation = ImGui::ComboSearchGeneration();
+	++search.builds;
+	return search;
+}
+}
+
+
+
 template <typename T>
 IMGUI_API bool ImGui::InputCombo(const char *label, std::string *input, T **element, const Set<T> &elements, std::function<bool(const std::string &)> sort)
 {
@@ -117,76 +160,94 @@ IMGUI_API bool ImGui::InputCombo(const char *label, std::string *input, T **elem
 			return true;
 		}
 
-		std::vector<std::pair<double, const char *>> weights;
-
-		// Filter the possible values using the provider filter function (if available)
-		// and perform a fuzzy search on the input to further limit the list.
-		if(!input->empty())
+		// The entries are cached until the query or the set of objects changes, so that
+		// the list only needs to be filtered and sorted once.
+		struct Results {
+			std::string query;
+			unsigned builds = 0;
+			std::vector<std::pair<double, const char *>> weights;
+		};
+		static std::unordered_map<ImGuiID, Results> cache;
+		const std::size_t maxResults = 100;
+
+		const auto &search = impl::ComboSearchFor(elements);
+		auto &results = cache[id];
+		if(IsWindowAppearing() || results.builds != search.builds || results.query != *input)
 		{
-			rapidfuzz::fuzz::CachedPartialRatio<char> scorer(*input);
-			const double scoreCutoff = .75;
-			for(const auto &it : elements)
+			const auto &names = search.index.Names();
+			const auto isAllowed = [&elements, &names, &sort](std::size_t index)
 			{
-				if(!IsValid(it.second, 0) || (sort && !sort(it.first)))
-					continue;
-
-				const double score = scorer.similarity(it.first, scoreCutoff);
-				if(score > scoreCutoff)
-					weights.emplace_back(score, it.first.c_str());
-			}
-
-			std::sort(weights.begin(), weights.end(),
-					[](const auto &lhs, const auto &rhs)
-					{
-						if(lhs.first == rhs.first)
-							return std::strcmp(lhs.second, rhs.second) < 0;
-						return lhs.first > rhs.first;
-					});
-		}
-		else
-		{
-			// If no input is provided sort the list by alphabetical order instead.
-			for(const auto &it : elements)
-				if(IsValid(it.second, 0) && (!sort || sort(it.first)))
-					weights.emplace_back(0., it.first.c_str());
-			std::sort(weights.begin(), weights.end(),
-					[](const auto &lhs, const auto &rhs)
-						{ return std::strcmp(lhs.second, rhs.second) < 0; });
+				const T *object = elements.Find(names[index]);
+				return object && IsValid(*object, 0) && (!sort || sort(names[index]));
+			};
+
+			results.query = *input;
+			results.builds = search.builds;
+			results.weights.clear();
+
+			// Filter the possible values using the provider filter function (if available)
+			// and perform a fuzzy search on the input to further limit the list.
+			if(!input->empty())
+				for(const auto &match : search.index.Search(*input, maxResults, isAllowed))
+					results.weights.emplace_back(match.score, names[match.index].c_str());
+			// If no input is provided list everything by alphabetical order instead,
+			// which is the order of the index.
+			else
+				for(std::size_t i = 0; i < names.size(); ++i)
+					if(isAllowed(i))
+						results.weights.emplace_back(0., names[i].c_str());
 		}
+		const auto &weights = results.weights;
 
 		if(!weights.empty())
 		{
-			auto topWeight = weights[0].first;
-			for(const auto &item : weights)
+			const auto select = [&element, &elements, &changed, &input](const char *name)
 			{
-				// Allow the user to select an entry in the combo box.
-				// This is a hack to workaround the fact that we change the focus when clicking an
-				// entry and that this means that the filtered list will change (breaking entries).
-				if(GetActiveID() == GetCurrentWindow()->GetID(item.second) || GetFocusID() == GetCurrentWindow()->GetID(item.second))
+				*element = const_cast<T *>(elements.Get(name));
+				changed = true;
+				*input = name;
+			};
+			// Allow the user to select an entry in the combo box.
+			// This is a hack to workaround the fact that we change the focus when clicking an
+			// entry and that this means that the filtered list will change (breaking entries).
+			const auto selectIfActive = [&select](const char *name)
+			{
+				if(GetActiveID() == GetCurrentWindow()->GetID(name) || GetFocusID() == GetCurrentWindow()->GetID(name))
 				{
-					*element = const_cast<T *>(elements.Get(item.second));
-					changed = true;
-					*input = item.second;
+					select(name);
 					CloseCurrentPopup();
 					SetActiveID(0, GetCurrentWindow());
 				}
+			};
+
+			// The entries are sorted by weight, so the ones that are good enough
+			// matches to be shown come first.
+			const auto topWeight = weights[0].first;
+			const std::size_t shown = topWeight
+				? std::partition_point(weights.begin(), weights.end(),
+						[topWeight](const auto &item) { return item.first >= topWeight * .45; }) - weights.begin()
+				: weights.size();
+			for(std::size_t i = shown; i < weights.size(); ++i)
+				selectIfActive(weights[i].second);
+
+			if(autocomplete)
+			{
+				select(weights[0].second);
+				autocomplete = false;
+				CloseCurrentPopup();
+				SetActiveID(0, GetCurrentWindow());
+			}
 
-				if(topWeight && item.first < topWeight * .45)
-					continue;
-
-				if(Selectable(item.second) || autocomplete)
+			// Only the entries that are actually visible are submitted.
+			ImGuiListClipper clipper;
+			clipper.Begin(static_cast<int>(shown));
+			while(clipper.Step())
+				for(int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i)
 				{
-					*element = const_cast<T *>(elements.Get(item.second));
-					changed = true;
-					*input = item.second;
-					if(autocomplete)
-					{
-						autocomplete = false;
-						CloseCurrentPopup();
-						SetActiveID(0, GetCurrentWindow());
-					}
+					selectIfActive(weights[i].second);
+					if(Selectable(weights[i].second))
+						select(weights[i].second);
 				}
-			}
 		}
 		EndCombo();
 	}
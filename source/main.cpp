@@ -12,6 +12,7 @@ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
 PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 */
 
+#include "ArenaSimulation.h"
 #include "Audio.h"
 #include "Command.h"
 #include "Conversation.h"
@@ -29,6 +30,7 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #include "GameLoadingPanel.h"
 #include "Hardpoint.h"
 #include "Logger.h"
+#include "MapShader.h"
 #include "MenuAnimationPanel.h"
 #include "MenuPanel.h"
 #include "Outfit.h"
@@ -49,12 +51,16 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #include "imgui_impl_opengl3.h"
 #include "nfd.h"
 
+#include <SDL2/SDL_hints.h>
+#include <SDL2/SDL_stdinc.h>
+
 #include <chrono>
 #include <iostream>
 #include <map>
 #include <thread>
 
 #include <cassert>
+#include <cstdlib>
 #include <future>
 #include <exception>
 #include <string>
@@ -71,6 +77,7 @@ using namespace std;
 void PrintHelp();
 void PrintVersion();
 void GameLoop();
+int RunArena(const string &path, const string &program, int worker, int workers);
 #ifdef _WIN32
 void InitConsole();
 #endif
@@ -88,6 +95,11 @@ int main(int argc, char *argv[])
 	// Ensure that we log errors to the errors.txt file.
 	Logger::SetLogErrorCallback([](const string &errorMessage) { Files::LogErrorToFile(errorMessage); });
 
+	string arenaPath;
+	// The arena runs its battles in copies of this program, which are told which
+	// of the runs are theirs.
+	int arenaWorker = 0;
+	int arenaWorkers = 0;
 	for(const char *const *it = argv + 1; *it; ++it)
 	{
 		string arg = *it;
@@ -101,12 +113,22 @@ int main(int argc, char *argv[])
 			PrintVersion();
 			return 0;
 		}
+		else if(arg == "--arena" && *(it + 1))
+			arenaPath = *++it;
+		else if(arg == "--arena-worker" && *(it + 1) && *(it + 2))
+		{
+			arenaWorker = atoi(*++it);
+			arenaWorkers = atoi(*++it);
+		}
 	}
 	Files::Init(argv);
 
 	try {
 		TaskQueue _;
 
+		if(!arenaPath.empty())
+			return RunArena(arenaPath, argv[0], arenaWorker, arenaWorkers);
+
 		// OpenAL needs to be initialized before we begin loading any sounds/music.
 		Audio::Init();
 
@@ -145,6 +167,7 @@ int main(int argc, char *argv[])
 
 
 		GameData::LoadShaders(!GameWindow::HasSwizzle());
+		MapShader::Init();
 
 		// Show something other than a blank window.
 		GameWindow::Step();
@@ -276,6 +299,53 @@ void GameLoop()
 		// Lock the framerate to 60fps.
 		timer.Wait();
 	}
+
+	// Don't quit in the middle of writing the plugin.
+	editor.FinishSave(true);
+}
+
+
+
+// Runs the arena simulations in the given file without showing the editor. If
+// given a number of workers, this is one of them.
+int RunArena(const string &path, const string &program, int worker, int workers)
+{
+	// OpenAL needs to be initialized before loading any sounds, even though the
+	// arena never plays them. Unless told otherwise, OpenAL Soft uses its null
+	// device, which works without any audio hardware.
+	SDL_setenv("ALSOFT_DRIVERS", "null", 0);
+	Audio::Init();
+	future<void> dataLoading = GameData::BeginLoad(0);
+	Preferences::Load();
+
+	// The collision masks of the ships are created while loading their sprites,
+	// which needs an OpenGL context. The window is never shown or drawn to, so
+	// without a display it is created by SDL's offscreen driver through EGL,
+	// which needs an SDL that was built with it.
+#ifdef __linux__
+	if(!SDL_getenv("DISPLAY") && !SDL_getenv("WAYLAND_DISPLAY"))
+		SDL_SetHint(SDL_HINT_VIDEODRIVER, "offscreen");
+#endif
+	if(!GameWindow::Init([](SDL_Window *window, const SDL_GLContext &)
+		{
+			SDL_HideWindow(window);
+		}))
+		return 1;
+
+	dataLoading.wait();
+	while(!GameData::IsLoaded())
+	{
+		TaskQueue::ProcessTasks();
+		GameData::GetProgress();
+	}
+
+	const int exitCode = workers > 0
+		? ArenaSimulation::RunWorker(path, worker, workers)
+		: ArenaSimulation::RunFile(path, program);
+
+	Audio::Quit();
+	GameWindow::Quit();
+	return exitCode;
 }
 
 
@@ -286,6 +356,9 @@ void PrintHelp()
 	cerr << "Command line options:" << endl;
 	cerr << "    -h, --help: print this help message." << endl;
 	cerr << "    -v, --version: print version information." << endl;
+	cerr << "    --arena <path>: run the arena battles in the given file without showing" << endl;
+	cerr << "        the editor, and print how often each side won. The battles are run" << endl;
+	cerr << "        on every core." << endl;
 	cerr << endl;
 	cerr << "Report bugs to: <https://github.com/quyykk/editor/issues>" << endl;
 	cerr << endl;
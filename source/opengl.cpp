@@ -73,3 +73,15 @@ bool OpenGL::HasSwizzleSupport()
 {
 	return GLAD_GL_ARB_texture_swizzle || GLAD_GL_EXT_texture_swizzle;
 }
+
+
+
+bool OpenGL::HasInstancingSupport()
+{
+#ifdef ES_GLES
+	return GLAD_GL_ES_VERSION_3_0;
+#else
+	// The loader only has the GL 3.0 entry points, so instancing has to use the extensions.
+	return GLAD_GL_ARB_instanced_arrays && GLAD_GL_ARB_draw_instanced;
+#endif
+}
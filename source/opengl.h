@@ -17,6 +17,7 @@ public:
 
 	static bool HasAdaptiveVSyncSupport();
 	static bool HasSwizzleSupport();
+	static bool HasInstancingSupport();
 };
 
 